@@ -0,0 +1,76 @@
+#ifndef ACCUM_H
+#define ACCUM_H
+
+#include "Hal.h"
+#include "Config.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Accum: streaming statistics of one integer quantity (count, minimum, maximum, mean, standard deviation) in a
+// fixed 32 bytes, whatever the sample rate. add() is O(1) per sample; merge() combines two accumulators
+// exactly, so an hour's statistics roll up into the day's at the boundary without keeping or rescanning samples.
+// The sums are kept as exact 64-bit integers (values are the integer results of the CSV fields), so merging
+// loses nothing, and the variance is taken about the rounded mean, so the subtraction does not cancel.
+
+class Accum {
+
+  public:
+  Accum() { clear(); }
+
+  void clear() {
+    _n = 0;
+    _min = INT32_MAX;
+    _max = INT32_MIN;
+    _sum = 0;
+    _sumSq = 0;
+  }
+
+  void add(int32_t v) {
+    _n++;
+    if (v < _min) _min = v;
+    if (v > _max) _max = v;
+    _sum += v;
+    _sumSq += (int64_t)v * v;
+  }
+
+  void merge(const Accum& a) {
+    _n += a._n;
+    if (a._min < _min) _min = a._min;
+    if (a._max > _max) _max = a._max;
+    _sum += a._sum;
+    _sumSq += a._sumSq;
+  }
+
+  uint32_t count() const { return _n; }
+  int32_t min() const { return _n ? _min : 0; }
+  int32_t max() const { return _n ? _max : 0; }
+  int64_t sum() const { return _sum; }
+
+  // mean(): rounded to the nearest integer (halves away from zero); 0 if empty
+  int32_t mean() const {
+    if (_n == 0) return 0;
+    return (int32_t)((_sum >= 0 ? _sum + _n / 2 : _sum - (int64_t)(_n / 2)) / (int64_t)_n);
+  }
+
+  /*********************************************************************************************************
+  sd(): population standard deviation, rounded: from the squares about the rounded mean m,
+  S = sumSq - 2 m sum + n m^2 (exact), less the rounding of m itself, (sum - n m)^2 / n
+  parameters: none
+  returns: int32_t: standard deviation (same units as the values); 0 if empty
+  **********************************************************************************************************/
+  int32_t sd() const {
+    if (_n == 0) return 0;
+    int64_t m = mean();
+    int64_t s = _sumSq - 2 * m * _sum + (int64_t)_n * m * m;
+    float d = (float)(_sum - (int64_t)_n * m);
+    float var = ((float)s - d * d / _n) / _n;
+    return (var > 0.0f) ? (int32_t)(sqrtf(var) + 0.5f) : 0;
+  }
+
+  private:
+  uint32_t _n;
+  int32_t _min, _max;
+  int64_t _sum;
+  int64_t _sumSq;
+};
+
+#endif
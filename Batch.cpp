@@ -0,0 +1,39 @@
+#include "Batch.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Batch class: fixed-size store of realtime samples waiting to be posted together
+
+Batch::Batch() {};
+
+/*********************************************************************************************************
+begin(): sets the flush criteria and empties the batch
+parameters:
+  maxSamples: int: flush once this many samples are held (0 or 1: batching off; capped at BATCH_MAX)
+  maxSecs: unsigned long: flush once the oldest sample is this many seconds old
+returns: void
+**********************************************************************************************************/
+void Batch::begin(int maxSamples, unsigned long maxSecs) {
+  if (maxSamples > BATCH_MAX) maxSamples = BATCH_MAX;
+  _maxSamples = maxSamples;
+  _maxSecs = maxSecs;
+  _count = 0;
+}
+
+/*********************************************************************************************************
+add(): appends a sample to the batch
+parameters: fr: rtFrame holding the sample
+returns: boolean: true if the batch is now full and must be flushed
+**********************************************************************************************************/
+bool Batch::add(const rtFrame& fr) {
+  if (_count < BATCH_MAX) _samples[_count++] = fr;
+  return _count >= _maxSamples;
+}
+
+/*********************************************************************************************************
+due(): checks the age of the oldest sample held
+parameters: now2k: unsigned long: time now (seconds since 1/1/2000)
+returns: boolean: true if there are samples and the oldest is at least maxSecs old
+**********************************************************************************************************/
+bool Batch::due(unsigned long now2k) {
+  return (_count > 0) && (now2k - _samples[0].time2k >= _maxSecs);
+}
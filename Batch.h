@@ -0,0 +1,32 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "Hal.h"
+#include "Config.h"
+#include "Telemetry.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Batch: accumulates realtime samples so that several go out in one MQTT message.
+// Each sample keeps its own timestamp (and sequence number): see Station::flushBatch() for the message formats.
+
+class Batch {
+
+  public:
+  Batch();
+  void begin(int maxSamples, unsigned long maxSecs);
+  bool add(const rtFrame& fr);
+  bool due(unsigned long now2k);
+  void clear() { _count = 0; }
+  bool enabled() { return _maxSamples > 1; }
+  int count() { return _count; }
+  const rtFrame& sample(int i) { return _samples[i]; }
+  const rtFrame* samples() { return _samples; }
+
+  private:
+  rtFrame _samples[BATCH_MAX];
+  int _count;
+  int _maxSamples;
+  unsigned long _maxSecs;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include "CatchUp.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// CatchUp class: walks the hours of a range catch-up (see CatchUp.h)
+
+CatchUp::CatchUp() : _active(false) {};
+
+/*********************************************************************************************************
+begin(): starts (or restarts) a catch-up
+parameters:
+  from: uint32_t: first hour (hours since 1/1/2000)
+  to: uint32_t: last hour (inclusive)
+  step: uint32_t: hours between records (resolution): 1 for every hour
+  seq: uint32_t: sequence number to start from (0, or the resume point)
+returns: boolean: true if the range is valid
+**********************************************************************************************************/
+bool CatchUp::begin(uint32_t from, uint32_t to, uint32_t step, uint32_t seq) {
+  _active = false;
+  if (step == 0 || to < from || (to - from) / step >= HIST_INDEX_LEN) return false;
+  _from = from;
+  _to = to;
+  _step = step;
+  _seq = seq;
+  _sent = 0;
+  _active = true;
+  return true;
+}
+
+/*********************************************************************************************************
+next(): hands out the next hour of the range, the same one until advance() is called
+parameters:
+  hour2k: uint32_t* to receive the hour (hours since 1/1/2000)
+  seq: uint32_t* to receive its sequence number
+returns: boolean: false once the range is exhausted (the catch-up is over when the caller stop()s it)
+**********************************************************************************************************/
+bool CatchUp::next(uint32_t* hour2k, uint32_t* seq) {
+  if (!_active) return false;
+  uint32_t h = _from + _seq * _step;
+  if (h > _to || h < _from) return false;
+  *hour2k = h;
+  *seq = _seq;
+  return true;
+}
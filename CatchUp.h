@@ -0,0 +1,32 @@
+#ifndef CATCHUP_H
+#define CATCHUP_H
+
+#include "Hal.h"
+#include "Config.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// CatchUp: state of a range catch-up requested by the Shed ("C<from>,<to>[,<step>[,<seq>]]", hours since
+// 1/1/2000). Record number seq of a range is always the hour from + seq * step, so an interrupted
+// catch-up is resumed by asking for the same range again from the last sequence number received.
+
+class CatchUp {
+
+  public:
+  CatchUp();
+  bool begin(uint32_t from, uint32_t to, uint32_t step, uint32_t seq);
+  bool next(uint32_t* hour2k, uint32_t* seq);
+  void advance() { _seq++; }  // the hour next() handed out is dealt with (posted, or not in the log)
+  void stop() { _active = false; }
+  bool active() { return _active; }
+  uint32_t seq() { return _seq; }
+  uint32_t sent() { return _sent; }
+  void countSent() { _sent++; }
+
+  private:
+  bool _active;
+  uint32_t _from, _to, _step;
+  uint32_t _seq;  // sequence number of the next hour to look at
+  uint32_t _sent;
+};
+
+#endif
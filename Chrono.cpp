@@ -1,46 +1,119 @@
-#include "Arduino.h"
+#include "Hal.h"
 #include "Chrono.h"
 
-// *********************** Version of 02/08/2024 *******************************************
+// *********************** Version of 17/10/2026 *******************************************
 // Chrono class is a utility serving 2 different but related purposes:
-// 1) it acts as a realtime clock, once fed with starter value from internet - from Comms class
+// 1) it acts as a realtime clock: seconds, dates and hour boundaries of the shared Timebase (set from the
+// internet by Comms, then disciplined by SNTP)
 // 2) it provides a variety of static methods for formatting and "date part" values of datetime,
 // given an unsigned long value as input parameter
 // Chrono internally stores the unix time MINUS seconds 1970-2000
+// Date parts come from a cached broken-down time which is advanced as now() moves on: the civil date
+// is only re-derived when a day boundary is crossed, the hour only when an hour boundary is crossed.
+
+// Civil date engine checks (days since 1/1/2000)
+static_assert(Chrono::daysFromCivil(2000, 1, 1) == 0, "epoch");
+static_assert(Chrono::daysFromCivil(2000, 2, 29) == 59, "leap day 2000");
+static_assert(Chrono::daysFromCivil(2000, 3, 1) == 60, "day after leap day");
+static_assert(Chrono::daysFromCivil(2000, 12, 31) == 365, "end of leap year");
+static_assert(Chrono::daysFromCivil(2001, 3, 1) == 425, "non-leap March");
+static_assert(Chrono::daysFromCivil(2024, 8, 13) == 8991, "mid range");
+static_assert(Chrono::daysFromCivil(2099, 12, 31) == 36524, "end of range");
+static_assert(Chrono::civilYear(0) == 2000 && Chrono::civilMonth(0) == 1 && Chrono::civilDate(0) == 1, "epoch");
+static_assert(Chrono::civilYear(59) == 2000 && Chrono::civilMonth(59) == 2 && Chrono::civilDate(59) == 29, "leap day");
+static_assert(Chrono::civilYear(365) == 2000 && Chrono::civilMonth(365) == 12 && Chrono::civilDate(365) == 31, "31/12/2000");
+static_assert(Chrono::civilYear(8991) == 2024 && Chrono::civilMonth(8991) == 8 && Chrono::civilDate(8991) == 13, "13/8/2024");
+static_assert(Chrono::civilYear(36524) == 2099 && Chrono::civilMonth(36524) == 12 && Chrono::civilDate(36524) == 31, "end");
 
 Chrono::Chrono() {};
 /**********************************************************************************************
-begin(): sets up Chrono clock, using value from internet where available
-parameters: unix2k: Unix time from internet, adjusted to year 2000 baseline - instead of 1970
+begin(): sets up Chrono clock on a Timebase (already begun)
+parameters: tb: Timebase&: the station's time
 returns: void
 ***********************************************************************************************/
-void Chrono::begin(unsigned long unix2k) {
-  _unix2k = unix2k;
-  if (unix2k == 0) _unix2k = now();
-  _ms = millis();
-  _prevHour = hour();
+void Chrono::begin(Timebase& tb) {
+  _tb = &tb;
+  _secEnd = 0ULL;
+  _dayStart = _nextDay = _hourStart = _nextHour = 0UL;  // empty cache: forces advance() to derive all fields
+  unsigned long u = now();
+  advance(u);
+  _prevHour = _hour;
+  _prevHourStamp = _hourStart / SECS_PER_HOUR;
+  _hourMark = _nextHour;
+  _dayMark = _nextDay;
 }
 
 /**********************************************************************************************
 now(): returns calculated time now as an unsigned long
+Within a second this is one compare (and the Timebase's generation): the Timebase is only read, and the
+64-bit division done, once per second. The second's end is reckoned at the crystal's rate, so a change of
+second may be seen up to CLOCK_SLEW_PPM + CLOCK_DRIFT_MAX_PPM late (0.7 ms).
 parameters: none
 returns: seconds since 1/1/2000 as unsigned long
 ***********************************************************************************************/
 unsigned long Chrono::now() {
-  unsigned long secs = (millis() - _ms) / 1000UL;
-  unsigned long rv = _unix2k + secs;
-  return rv; 
+  uint64_t mono = halMicros64();
+  uint32_t gen = _tb->generation();
+  if (mono < _secEnd && gen == _tbGen) return _sec;
+  uint64_t us = _tb->toUs(mono);
+  _sec = (unsigned long)(us / 1000000ULL);
+  _secEnd = mono + (1000000ULL - us % 1000000ULL);
+  _tbGen = gen;
+  return _sec;
 }  // Unix value (>1/1/2000)
 
+/*************************************************************************************************
+advance(): brings the cached broken-down time up to u
+Moving forward within the same day only re-derives the hour (and only when the hour boundary is passed);
+the civil date is recomputed when u leaves the cached day (either direction).
+parameters: u: unsigned long representing seconds since 1/1/2000
+returns: void
+**************************************************************************************************/
+void Chrono::advance(unsigned long u) {
+  if (u >= _nextDay || u < _dayStart) {
+    long days = (long)(u / SECS_PER_DAY);
+    _year = civilYear(days);
+    _month = civilMonth(days);
+    _date = civilDate(days);
+    _doy = (int)(days - daysFromCivil(_year, 1, 1));
+    _dayStart = (unsigned long)days * SECS_PER_DAY;
+    _nextDay = _dayStart + SECS_PER_DAY;
+    _nextHour = _hourStart = _dayStart;  // hour must be re-derived too
+  }
+  if (u >= _nextHour || u < _hourStart) {
+    _hour = (int)((u - _dayStart) / SECS_PER_HOUR);
+    _hourStart = _dayStart + (unsigned long)_hour * SECS_PER_HOUR;
+    _nextHour = _hourStart + SECS_PER_HOUR;
+  }
+}
+
 /************************************************************************************************
 hourChanged(): checks if hour has changed since the last call (i.e. previous loop)
+A single compare against the precomputed next hour boundary until that boundary is reached.
 parameters: none
 returns: boolean: true if hour changed, otherwise false
 *************************************************************************************************/
 bool Chrono::hourChanged() {
-  bool b = (hour() != _prevHour);
-  _prevHour = hour();
-  return b;
+  unsigned long u = now();
+  if (u < _hourMark) return false;
+  _prevHour = Hour(_hourMark - 1UL);  // the hour which has just ended
+  _prevHourStamp = (_hourMark - 1UL) / SECS_PER_HOUR;
+  advance(u);
+  _hourMark = _nextHour;
+  return true;
+}
+
+/************************************************************************************************
+dayChanged(): checks if the date has changed since the last call
+parameters: none
+returns: boolean: true if day changed, otherwise false
+*************************************************************************************************/
+bool Chrono::dayChanged() {
+  unsigned long u = now();
+  if (u < _dayMark) return false;
+  advance(u);
+  _dayMark = _nextDay;
+  return true;
 }
 
 /*************************************************************************************************
@@ -49,11 +122,8 @@ parameters: u: unsigned long representing seconds since 1/1/2000
 returns: int: calculated year
 **************************************************************************************************/
 int Chrono::Year(unsigned long u) {
-  int d2000 = u / SECS_PER_DAY;  // days since 01.01.2000
-  int quads = d2000 / DAYS_PER_QUAD; // (rounded down)
-  int dslq = d2000 - DAYS_PER_QUAD * quads; // days since last quad start
-  int yslq = (dslq < DPY + 1) ? 0 : 1 + (dslq - DPY - 1) / DPY;  // (rounded down)
-  return 2000 + quads * 4 + yslq; 
+  advance(u);
+  return _year;
 }
 
 /*************************************************************************************************
@@ -62,11 +132,8 @@ parameters: u: unsigned long representing seconds since 1/1/2000
 returns: int: calculated day of year
 ***************************************************************************************************/
 int Chrono::DoY(unsigned long u) {
-  int ys2k = Chrono::Year(u) - 2000;
-  int qs2k = ys2k / 4;
-  int yslq = ys2k - qs2k * 4; // must be 0-3
-  int ds2k = (int)(u / SECS_PER_DAY);
-  return ds2k - (yslq * DPY) - (qs2k * DAYS_PER_QUAD);  // day of year: zero-based
+  advance(u);
+  return _doy;  // day of year: zero-based
 }
 
 /*************************************************************************************************
@@ -75,15 +142,8 @@ parameters: u: unsigned long representing seconds since 1/1/2000
 returns: int: calculated month
 ***************************************************************************************************/
 int Chrono::Month(unsigned long u) { 
-  int y = Chrono::Year(u);
-  int doyr = DoY(u);
-  bool leap = (y % 4) == 0;
-  int adjust = leap && (doyr > 58) ? 1 : 0;
-  int i;
-  for (i = 1; i < MPY; i++) {
-    if (doyr < _dd[i] + adjust) return i;
-  }
-  return 12;
+  advance(u);
+  return _month;
 }
 
 /*************************************************************************************************
@@ -92,14 +152,8 @@ parameters: u: unsigned long representing seconds since 1/1/2000
 returns: int: calculated day of month
 ***************************************************************************************************/
 int Chrono::Date(unsigned long u) {
-  int mth = Chrono::Month(u);
-  int doyr = Chrono::DoY(u);
-  int m1 = _dd[mth];
-  int i;
-  for (i = 1; i < DPM; i++) {
-    if ((doyr > _dd[i - 1]) && (doyr <= _dd[i])) return doyr - _dd[i - 1];
-  }
-  return doyr - _dd[11];
+  advance(u);
+  return _date;
 }
 
 /*************************************************************************************************
@@ -108,8 +162,8 @@ parameters: u: unsigned long representing seconds since 1/1/2000
 returns: int: calculated hour 
 ***************************************************************************************************/
 int Chrono::Hour(unsigned long u) {
-  int secs = u % SECS_PER_DAY;
-  return (int)(secs / SECS_PER_HOUR);
+  advance(u);
+  return _hour;
 }
 
 /*************************************************************************************************
@@ -121,8 +175,12 @@ returns: char*: calculated date/time (ISO)
 ***************************************************************************************************/
 char* Chrono::nowISO(int truncate) {
   unsigned long unix2k = now();
-  sprintf(_isoNowBuf, "%d-%02d-%02dT%02d:%02d:%02d", Year(unix2k), Month(unix2k), Date(unix2k), Hour(unix2k), Minutes(unix2k),
-    Seconds(unix2k));
+  advance(unix2k);
+  if (snprintf(_isoNowBuf, sizeof(_isoNowBuf), "%d-%02d-%02dT%02d:%02d:%02d", _year, _month, _date, _hour,
+    Minutes(unix2k), Seconds(unix2k)) >= (int)sizeof(_isoNowBuf)) {
+    _isoNowBuf[0] = '\0';  // not a date: cannot happen before 2136
+    return _isoNowBuf;
+  }
   if (truncate != TRUNC_NONE) {
     if (truncate == TRUNC_HOUR) strcpy(_isoNowBuf + truncate, "00:00");
     else strcpy(_isoNowBuf + truncate, "00:00:00");
@@ -131,40 +189,39 @@ char* Chrono::nowISO(int truncate) {
 }
 
 /*************************************************************************************************
-Minutes(): gets minutes (0-59) from unsigned long input
+Minutes(): gets minutes (0-59) from unsigned long input (cache must already be advanced to u)
 parameters: u: unsigned long representing seconds since 1/1/2000
 returns: int: calculated minutes 
 ***************************************************************************************************/
 int Chrono::Minutes(unsigned long u) {
-  int secs = u % SECS_PER_HOUR;
-  return (int)(secs / SECS_PER_MINUTE);
+  int secs = (int)(u - _hourStart);
+  return secs / SECS_PER_MINUTE;
 }
 
 /*************************************************************************************************
-Seconds(): gets seconds (0-59) from unsigned long input
+Seconds(): gets seconds (0-59) from unsigned long input (cache must already be advanced to u)
 parameters: u: unsigned long representing seconds since 1/1/2000
 returns: int: calculated seconds 
 ***************************************************************************************************/
 int Chrono::Seconds(unsigned long u) {
-  return u % SECS_PER_MINUTE;
+  int secs = (int)(u - _hourStart);
+  return secs % SECS_PER_MINUTE;
 }
 
 /**************************************************************************************************
 getIsoDate(): places ISO formatted date for now in buffer buf from day and hour data only
 NB: Returns ISO date for yesterday if date/hour combination is later than time now.
 parameters:
-  buf: character buffer to receive data (20 bytes minimum)
+  buf: character buffer to receive data (ISO_LEN bytes minimum)
   dy: int date (1-31)
   hr: int hour (0-23)
 returns: ISO formatted date/time string
 ****************************************************************************************************/
 char* Chrono::getIsoDate(char* buf, int dy, int hr) {
-  unsigned long u = now();
-  int y = Year(u);
-  int m = Month(u);
-  int d = Date(u);
-  int h = Hour(u);
-  int hd = d * 24 + h;
+  advance(now());
+  int y = _year;
+  int m = _month;
+  int hd = _date * 24 + _hour;
   if ((dy * 24 + hr) > hd) {  // assumes shed is asking for yesterday's data
     m--;
     if (m == 0) {
@@ -175,7 +232,30 @@ char* Chrono::getIsoDate(char* buf, int dy, int hr) {
   }
   // if now < yyyy-mm-ddThh:00:00 stored values must be for last month!
 
-  sprintf(buf, "%d-%02d-%02dT%02d:00:00", y, m, dy, hr);
+  snprintf(buf, ISO_LEN, "%d-%02d-%02dT%02d:00:00", y, m, dy, hr);
   return buf;
 }
 
+/**************************************************************************************************
+hourStamp(): hours since 1/1/2000 for a date (day of month) and hour, as asked for by the Shed
+NB: as getIsoDate(), assumes last month if the date/hour combination is later than time now.
+parameters:
+  dy: int date (1-31)
+  hr: int hour (0-23)
+returns: unsigned long: hours since 1/1/2000, NO_HOUR_STAMP if the month has no such date (31/4, say)
+****************************************************************************************************/
+unsigned long Chrono::hourStamp(int dy, int hr) {
+  advance(now());
+  int y = _year;
+  int m = _month;
+  if ((dy * 24 + hr) > (_date * 24 + _hour)) {
+    m--;
+    if (m == 0) {
+      m = 12;
+      y--;
+    }
+  }
+  long days = daysFromCivil(y, m, dy);
+  if (civilDate(days) != dy) return NO_HOUR_STAMP;  // past the month's end: a date of the next month
+  return (unsigned long)days * HPD + hr;
+}
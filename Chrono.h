@@ -1,10 +1,11 @@
 #ifndef CHRONO_H
 #define CHRONO_H
 
-#include "Arduino.h"
+#include "Hal.h"
 #include "Config.h"
+#include "Timebase.h"
 
-/* Chrono: class to add Clock functionality to Roof processor
+/* Chrono: class to add Clock functionality to Roof processor: dates and hour boundaries of the Timebase's time
 */
 #define TRUNC_NONE 0
 #define TRUNC_HOUR 14
@@ -14,12 +15,14 @@
 #define SECS_PER_MINUTE 60
 #define MINS_PER_HOUR 60
 #define DAYS_PER_QUAD 1461
+#define DAYS_1996_03_TO_2000 1401  // 1/3/1996 (start of a March-based leap quad) to 1/1/2000
+#define NO_HOUR_STAMP 0xffffffffUL  // hourStamp() of a date its month does not have
 
 class Chrono {
 
   public:
   Chrono();
-  void begin(unsigned long unix = 0L);
+  void begin(Timebase& tb);
   unsigned long now();
   int Year(unsigned long u);
   int Month(unsigned long u);
@@ -31,18 +34,54 @@ class Chrono {
   char* nowISO(int truncate);
 
   bool hourChanged();
+  bool dayChanged();
+  int prevHour() { return _prevHour; }
+  unsigned long prevHourStamp() { return _prevHourStamp; }
+  unsigned long hourStamp(int dy, int hr);
   char* getIsoDate(char* buf, int dy, int hr);
-  
+
+  // Civil date <-> days since 1/1/2000, valid 2000-2099. Years are counted from 1st March so that
+  // the leap day is the last day of each 4-year quad: no month table, no loops.
+  static constexpr long daysFromCivil(int y, int m, int d) {
+    return 365L * (y - (m <= 2 ? 1 : 0) - 1996) + (y - (m <= 2 ? 1 : 0) - 1996) / 4
+      + (153 * ((m + 9) % MPY) + 2) / 5 + d - 1 - DAYS_1996_03_TO_2000;
+  }
+  static constexpr int civilYear(long days) {
+    return 1996 + 4 * (int)((days + DAYS_1996_03_TO_2000) / DAYS_PER_QUAD) + yearOfQuad(days)
+      + (civilMonth(days) <= 2 ? 1 : 0);
+  }
+  static constexpr int civilMonth(long days) {
+    return marchMonth(days) < 10 ? marchMonth(days) + 3 : marchMonth(days) - 9;
+  }
+  static constexpr int civilDate(long days) {
+    return marchDoY(days) - (153 * marchMonth(days) + 2) / 5 + 1;
+  }
+
   private:
-  unsigned long _unix2k;
-  unsigned long _ms;
-  int _dd[MPY] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+  static constexpr int quadDay(long days) { return (int)((days + DAYS_1996_03_TO_2000) % DAYS_PER_QUAD); }
+  static constexpr int yearOfQuad(long days) { return (quadDay(days) - quadDay(days) / (DAYS_PER_QUAD - 1)) / DPY; }
+  static constexpr int marchDoY(long days) { return quadDay(days) - DPY * yearOfQuad(days); }
+  static constexpr int marchMonth(long days) { return (5 * marchDoY(days) + 2) / 153; }
+
+  void advance(unsigned long u);
   int Minutes(unsigned long u);
   int Seconds(unsigned long u);
 
+  Timebase* _tb;
+  // now(): the second, valid until halMicros64() reaches _secEnd or the Timebase's model changes
+  unsigned long _sec;
+  uint64_t _secEnd;
+  uint32_t _tbGen;
   char _isoNowBuf[ISO_LEN];
-  
-  int _prevHour, _prevMin, _thisHour;
+
+  // Cached broken-down time: date fields are only re-derived when u leaves [_dayStart, _nextDay)
+  int _year, _month, _date, _doy, _hour;
+  unsigned long _dayStart, _nextDay, _hourStart, _nextHour;
+
+  // Boundaries for hourChanged() / dayChanged(): one compare per call until the boundary is reached
+  unsigned long _hourMark, _dayMark;
+  int _prevHour;
+  unsigned long _prevHourStamp;  // hours since 1/1/2000 of the hour which has just ended
 
 };
 
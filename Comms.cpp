@@ -1,95 +1,189 @@
 #include "Comms.h"
 #include "Arduino.h"
+#include "Hal.h"
+#include <Preferences.h>
+#include <time.h>
 
 // class Comms: responsible for wifi (but not MQTT) communications
 // Also reads stored Wifi login credentials
+// Nothing here waits: begin() starts the join and returns, the WiFi driver's events do the rest. The last good
+// network (BSSID, channel and DHCP lease) is remembered in NVS and joined directly at the next boot, without a
+// scan or DHCP; only if that fails is the air scanned for the strongest known network. The time is set later,
+// in the background, by SNTP (see Timebase): sampling starts straight away.
 
-// -------------------------------- Version of 11/08/2024 --------------------------------------------
+// -------------------------------- Version of 17/10/2026 --------------------------------------------
 Comms::Comms() {};  // empty constructor
 
 /*****************************************************************************************************
-begin(): initiation code for Comms object: connects to Wifi and sets Clock from the internet
+begin(): initiation code for Comms object: starts joining Wifi (the remembered network if any, else the
+strongest known one) and returns without waiting
 parameters: none
 returns: void
 ******************************************************************************************************/
 void Comms::begin() {
-  // Set WiFi to station mode and disconnect from an AP if it was previously connected.
-  WiFi.mode(WIFI_STA);
-  WiFi.disconnect();
   readCredentials();  // gets all networks' router credentials
-  //Serial.println("Preferences read.");
-  if (!connectToWiFi()) {
-    _status = 1;
-    Serial.println("WiFi connection failed.");
-  
-    while(1) {
-      digitalWrite(LEDPin, !digitalRead(LEDPin));
-      delay(200);
-    };
-  }
-  _tt = calculateTime();
-  if (_tt == 0UL) {
-    Serial.println("Unable to get time from internet.");
-    _status = 2;
+  _nwkIx = -1;
+  _fast = false;
+  _joinMs = 0;
+  _ipAddress[0] = '\0';
+  WiFi.persistent(false);  // the remembered network is ours (NVS): no flash writes by the driver
+  WiFi.mode(WIFI_STA);
+  WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) { onEvent(event, info); });
+  Preferences prefs;
+  prefs.begin(WIFI_MEMO_NS, true);
+  bool known = prefs.getBytes("memo", &_memo, sizeof(_memo)) == sizeof(_memo) && _memo.magic == WIFI_MEMO_MAGIC
+    && _memo.nwk >= 0 && _memo.nwk < NUM_NETWORKS;
+  prefs.end();
+  if (known) fastJoin();
+  else startScan();
+}
+
+/********************************************************************************************************
+onEvent(): WiFi driver events (WiFi event task): completes or falls back from a join
+  got IP: joined; the network is remembered for the next boot
+  disconnected during a fast join: the remembered network is stale: scan instead
+  scan done: joins the strongest known network (or scans again)
+parameters: event, info: from the driver
+returns: void
+*********************************************************************************************************/
+void Comms::onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      strcpy(_ipAddress, WiFi.localIP().toString().c_str());  // this is IP address for HUB, NOT MQTT server!
+      if (_joinMs == 0) {
+        char mBuf[BUF_LEN];
+        _joinMs = halMillis();
+        sprintf(mBuf, "WiFi joined %lu ms after boot (%s); IP %s", _joinMs, _fast ? "remembered" : "scanned", _ipAddress);
+        halLog(mBuf);
+      }
+      _fast = false;
+      remember();
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      if (_fast) {
+        _fast = false;
+        WiFi.disconnect();
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // back to DHCP
+        startScan();
+      }
+      break;  // otherwise the driver reconnects by itself
+    case ARDUINO_EVENT_WIFI_SCAN_DONE:
+      joinBest();
+      break;
+    default:
+      break;
   }
-  else _status = 0;
 }
 
 /********************************************************************************************************
-connectToWiFi(): scans wifi networks and choose a match with Shed or Home
+fastJoin(): joins the remembered network directly: its BSSID and channel (no scan) and its last lease as a
+static configuration (no DHCP exchange)
+parameters: none
+returns: void
+*********************************************************************************************************/
+void Comms::fastJoin() {
+  _fast = true;
+  _nwkIx = _memo.nwk;
+  WiFi.config(IPAddress(_memo.ip), IPAddress(_memo.gateway), IPAddress(_memo.mask), IPAddress(_memo.dns));
+  WiFi.begin(_ssid[_nwkIx], _pwd[_nwkIx], _memo.channel, _memo.bssid, true);
+}
+
+/********************************************************************************************************
+startScan(): starts an asynchronous scan: the result comes as a scan done event
 parameters: none
-Returns: boolean: true if successful
+returns: void
 *********************************************************************************************************/
-bool Comms::connectToWiFi() {
-  WiFi.mode(WIFI_STA);
-  Serial.print("WiFi Connecting...");
-  // Scan and choose network to connect
-  WiFi.disconnect();
-  int nn = WiFi.scanNetworks();
-  if (nn > 0) {
-    int i, j;
-    for (i = 0; i < nn; i++) {
-      for (j = 0; j < NUM_NETWORKS; j++) {
-        if (strcmp(WiFi.SSID(i).c_str(), _ssid[j]) == 0) {
-          strcpy(_ssidChosen, _ssid[j]);
-          strcpy(_pwdChosen, _pwd[j]);
-          _nwkIx = j;
-        }
+void Comms::startScan() {
+  WiFi.scanNetworks(true);
+}
+
+/********************************************************************************************************
+joinBest(): joins the strongest scanned network that is in the credentials; scans again if there is none.
+Each scanned SSID is read once into the same String and compared in place.
+parameters: none
+returns: void
+*********************************************************************************************************/
+void Comms::joinBest() {
+  int nn = WiFi.scanComplete();
+  int best = -1, bestNwk = -1;
+  int32_t bestRssi = -1000;
+  String ssid;
+  uint8_t enc;
+  int32_t rssi, channel;
+  uint8_t* bssid;
+  for (int i = 0; i < nn; i++) {
+    if (!WiFi.getNetworkInfo(i, ssid, enc, rssi, bssid, channel) || rssi <= bestRssi) continue;
+    for (int j = 0; j < NUM_NETWORKS; j++) {
+      if (strcmp(ssid.c_str(), _ssid[j]) == 0) {
+        best = i;
+        bestNwk = j;
+        bestRssi = rssi;
+        break;
       }
     }
   }
-  else return false;
-  
-  // Now attempt connection to chosen network
-  int numTries = 0;
-  WiFi.disconnect();
-  WiFi.begin(_ssidChosen, _pwdChosen);
-  WiFi.waitForConnectResult();
-  while ((WiFi.status() != WL_CONNECTED) && numTries++ < 5) {
-    delay(100);
+  if (best < 0) {
+    WiFi.scanDelete();
+    startScan();
+    return;
   }
-  //Serial.print("Status: "); Serial.println(WiFi.status());
-  Serial.print("WiFi connected. IP Address: ");
-  strcpy(_ipAddress, WiFi.localIP().toString().c_str());
-  Serial.println(_ipAddress); // this is IP address for HUB, NOT MQTT server!
-  return true;
+  WiFi.getNetworkInfo(best, ssid, enc, rssi, bssid, channel);
+  _nwkIx = bestNwk;
+  WiFi.begin(_ssid[bestNwk], _pwd[bestNwk], channel, bssid, true);
+  WiFi.scanDelete();
+}
+
+/********************************************************************************************************
+remember(): keeps the network just joined in NVS (only if it changed: no flash wear at every boot)
+parameters: none
+returns: void
+*********************************************************************************************************/
+void Comms::remember() {
+  wifiMemo m;
+  memset(&m, 0, sizeof(m));
+  m.magic = WIFI_MEMO_MAGIC;
+  m.nwk = (int8_t)_nwkIx;
+  m.channel = (uint8_t)WiFi.channel();
+  memcpy(m.bssid, WiFi.BSSID(), sizeof(m.bssid));
+  m.ip = (uint32_t)WiFi.localIP();
+  m.gateway = (uint32_t)WiFi.gatewayIP();
+  m.mask = (uint32_t)WiFi.subnetMask();
+  m.dns = (uint32_t)WiFi.dnsIP();
+  if (memcmp(&m, &_memo, sizeof(m)) == 0) return;
+  _memo = m;
+  Preferences prefs;
+  prefs.begin(WIFI_MEMO_NS, false);
+  prefs.putBytes("memo", &m, sizeof(m));
+  prefs.end();
 }
 
 /***************************************************************************************************
 nwkIndex(): reports which Wifi was found
 parameters: none
-returns: int: index of found network
+returns: int: index of found network, -1 until one is chosen
 *****************************************************************************************************/
 int Comms::nwkIndex() {
   return _nwkIx;
 }
 
+/*****************************************************************************************************
+timeStamp(): the system time, if it is already known: the RTC keeps it across a software restart (e.g. the
+watchdog), not across a power cut
+parameters: none
+returns: unsigned long: seconds since 1/1/2000, 0 if unknown (SNTP will set it)
+******************************************************************************************************/
+unsigned long Comms::timeStamp() {
+  time_t t = time(NULL);
+  if (t < (time_t)(SECS_1970_TO_2000 + TIME_VALID_2K)) return 0UL;
+  return (unsigned long)(t - SECS_1970_TO_2000);
+}
+
 /*****************************************************************************************************
 readCredentials(): reads the login credentials of allowed Wifi networks
 parameters: none
 returns: boolen: always true
 ******************************************************************************************************/
-// readPreferences():          
+// readPreferences():
 bool Comms::readCredentials() {
   strcpy(_ssid[0], SHED_SSID);
   strcpy(_pwd[0], SHED_PWD);
@@ -99,33 +193,3 @@ bool Comms::readCredentials() {
   strcpy(_pwd[2], RICH_PWD);
   return true;
 }
-
-/*****************************************************************************************************
-calculateTime(): returns unsigned long int (Unix time) from website
-parameters: none
-returns: unsigned long integer representing time (seconds since 1/1/2000) if successful, 0 otherwise
-******************************************************************************************************/
- unsigned long Comms::calculateTime() {
-  const int DPQ = 1461; // days per quadyear
-  const int SPD = 86400;
-  const int SPH = 3600;
-  const int SPM = 60;
-  // setup this after wifi connected
-  delay(100);
-  configTime(0, 0, "europe.pool.ntp.org");
-  struct tm timeinfo;
-  Serial.println("Please be patient. This sometimes takes several seconds:");
-  while (!getLocalTime(&timeinfo)) {
-    Serial.print(">");
-  }
-
-  // Now convert struct tm to "seconds since midnight 1st Jan 2000"
-  int q2k = (timeinfo.tm_year - 100) / 4;
-  unsigned int d = q2k * DPQ;
-  int yOffset = timeinfo.tm_year % 4;
-  int dsq = (yOffset == 0) ? 0 : 1 + yOffset * DPY;  // DPY == 365
-  d += dsq;
-  unsigned long t = d * SPD + (timeinfo.tm_yday * SPD) + (timeinfo.tm_hour * SPH) + (timeinfo.tm_min * SPM) +
-    timeinfo.tm_sec;
-  return t;
-  }
@@ -3,28 +3,40 @@
 #include <WiFi.h>
 #include "Config.h"
 
+// Structure remembering the last network joined (NVS): enough to join it again without a scan or DHCP
+struct wifiMemo {
+  uint8_t magic;  // WIFI_MEMO_MAGIC when valid
+  int8_t nwk;  // index of the network in the credentials
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint32_t ip, gateway, mask, dns;  // DHCP lease, reused as a static configuration
+};
+
 class Comms {
-  
+
   public:
   Comms();
   void begin();
   int nwkIndex();
-  unsigned long timeStamp() { return _tt; }
+  unsigned long timeStamp();
 
   private:
   bool readCredentials(); // gets "menu" of wifi networks from code
-  bool connectToWiFi();
+  void onEvent(arduino_event_id_t event, arduino_event_info_t info);
+  void fastJoin();
+  void startScan();
+  void joinBest();
+  void remember();
   const char* getIP() { return _ipAddress; }
-  unsigned long calculateTime();
-  
-  unsigned long _tt;
-  int _status;
+
   int _nwkIx;
-  
+  bool _fast;  // joining the remembered network
+  unsigned long _joinMs;  // halMillis() when the first join completed (0: not yet)
+  wifiMemo _memo;
+
   char _ssid[NUM_NETWORKS][SSID_LEN];
   char _pwd[NUM_NETWORKS][PWD_LEN];
-  char _ssidChosen[SSID_LEN], _pwdChosen[PWD_LEN];
-  char _ipAddress[IP_LEN];  
-  
+  char _ipAddress[IP_LEN];
+
 };
 #endif
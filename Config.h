@@ -15,6 +15,8 @@
 #define SHED_PWD "UJDafGKptCvXb4"
 #define HOME_PWD "yJrbR6x6TkDP7g"
 #define RICH_PWD "starwest"
+#define WIFI_MEMO_NS "comms"  // NVS namespace of the last network joined (Comms)
+#define WIFI_MEMO_MAGIC 0xC1
 
 // MQTT
 #define SHED_IP "192.168.1.249"
@@ -27,8 +29,22 @@
 #define CATCHUP_LEN 164
 #define ICBUF_LEN 10
 #define HRREQ_LEN 6 // length of hourly i/c request message: HxxDxx (hour and date requested)
+#define BATCH_MAX 20  // most realtime samples in one batched message (20 == 1 minute)
+#define BATCH_SECS 60  // default oldest sample age (seconds) that forces a batch out
+#define BATCH_BUF_LEN (BATCH_MAX * (BUF_LEN + 8))  // batched CSV message, traced (worst case checked in Station.cpp)
+#define DAY_BLOCK_MAX 1536  // compressed day of hourly records (DayCodec): about 1050 bytes in practice
+#define QT_PACKET_LEN ((BATCH_BUF_LEN > DAY_BLOCK_MAX ? BATCH_BUF_LEN : DAY_BLOCK_MAX) + 64)  // MQTT client buffer: largest message plus topic and header
 
-#define NUL_WD 18  // code for wind direction NULL value
+#define NUL_WD 999  // wind direction NULL value (calm or no vane readings): outside 0-359 degrees
+
+// CSV versions of the 'R', 'B', 'H' and 'K' fields, set by the Shed request "Vn" ('D' messages and binary frames
+// always carry the current units):
+//   1: as before the continuous ADC: wind direction the raw vane reading (0-4095), NUL_WD_V1 when there is none
+//      and always in 'H'/'K'; battery the raw reading (0-4095)
+//   2: wind direction in degrees (0-359, NUL_WD when calm or no readings); battery in centivolts
+#define CSV_VERSION 1  // at boot: old consumers keep working until the Shed asks for version 2
+#define CSV_VERSION_MAX 2
+#define NUL_WD_V1 18  // version 1 wind direction NULL value
 
 // Timings, etc
 #define LOOP_TIME 250  // milliseconds
@@ -37,23 +53,104 @@
 #define ZONE12 12
 #define ZONE40 40
 #define ZONE0 120
+#define SCHED_MAX_JOBS 8
+
+// Latency statistics (ws/stats)
+#define STATS_SECS 300  // reporting period
+#define STATS_TICKS (STATS_SECS * 1000 / LOOP_TIME)
+#define STAT_NAME_LEN 10
+#define STAT_QUEUE_LEN 2  // closed periods queued by the sampling task (power of 2)
+#define STATS_BUF_LEN 640
+
+// Anemometer and rain gauge pulse capture
+#define PULSE_COUNTER 1  // count pulses in the PCNT peripheral (0, or no unit free: an interrupt per edge)
+#define WIND_PULSE_COUNTER 0  // the anemometer in a PCNT unit too: for a bounce-free (Hall effect) sensor only
+#define PULSE_COUNTERS 2  // counter units used
+#define WIND_COUNTER 0  // counter unit of the anemometer
+#define RAIN_COUNTER 1  // counter unit of the rain gauge
+#define PULSE_FILTER_NS 12000UL  // PCNT glitch filter: shorter pulses are ignored (hardware limit 12.7 us)
+#define RAIN_TIPS_POLL_MAX 1  // most tips counted per 1 sec poll: a bucket cannot tip faster, a bouncing reed can
+#define PULSE_RING_LEN 256  // pulse timestamps held between drains by the main code (power of 2)
+#define PULSE_MARGIN_US 5000UL  // minimum microseconds between edges: insurance against contact bounce
+
+// Wind statistics (WindStats)
+#define WS_BIN_US 250000UL  // pulse counting interval: 0.25 sec
+#define WS_GUST_BINS 12  // 3 sec gust
+#define WS_2MIN_BINS 480
+#define WS_10MIN_BINS 2400
+#define WS_RING_LEN (WS_10MIN_BINS + 1)
+#define WS_HIST_BINS 12  // hourly speed histogram bands
+#define WS_HIST_WIDTH 4  // revs per 3 sec in each band
+
+// Hourly history log (HistLog): 8 segments of one week each
+#define HIST_SEGMENTS 8
+#define HIST_SEG_RECORDS 168
+#define HIST_INDEX_LEN (HIST_SEGMENTS * HIST_SEG_RECORDS)
+#define HIST_PATH_LEN 48
+#define CATCHUP_PER_TICK 4  // most range catch-up records posted per network tick
+#define CATCHUP_BUDGET_MS (NET_TICK_MS / 2)  // no catch-up record is started after this much of the tick
 
-#define POLL_COUNT 12  // number of loops between successive revs calculations 
+// Store-and-forward (Forward): realtime samples held while the broker is unreachable
+#define FWD_SAMPLES 1280  // FRAME_LEN bytes each: just over an hour of 3 sec samples
+#define FWD_INTERVAL_MS 250  // at most one replayed batch (BATCH_MAX samples) per interval
+
+// MQTT connection (MqttLink): backoff after a failed attempt doubles from MIN up to MAX
+#define MQTT_BACKOFF_MIN_MS 1000UL
+#define MQTT_BACKOFF_MAX_MS 60000UL
+#define MQTT_SOCKET_SECS 2  // client read timeout, bounds a connect handshake with a silent broker
+
+// ADC: vane and battery converted continuously in the background (DMA), collected every tick
+#define ADC_HZ 20000UL  // conversions per second, both pins (the ESP32's lowest continuous rate)
+#define ADC_BUF_BYTES 16384  // DMA result pool: 0.4 secs of conversions, over a tick and a half
+#define ADC_FRAME_BYTES 256  // one DMA frame: 128 conversions
+#define ADC_CHUNK 32  // adcSample entries collected per HAL call (one per pin per DMA frame: 16 frames)
+#define WD_NORTH_RAW 0  // vane reading (0-4095) when it points north
+#define BATT_DIVIDER 2  // battery to VoltsPin resistor divider ratio
+
+// I2C sensors
+#define I2C_HZ 400000UL  // fast mode
+#define SENS_CYCLE ZONE40  // ticks per acquisition cycle (10 secs)
+#define BMP_OSS 3  // BMP085 pressure oversampling (ultra high resolution)
+// This unit's calibration (SensConv), one { gain (4096 = 1), offset (1/256 units) } per result:
+// temperature (C), humidity (%RH), pressure (hPa), lightA, lightB (13 ln(1 + lux)): -0.5 keeps the pressure and
+// light levels truncated, as they always have been
+#define CONV_CAL { { 4096, 0 }, { 4096, 0 }, { 4096, -128 }, { 4096, -128 }, { 4096, -128 } }
+
+// Tasks (ESP32): sampling on the APP core, networking on the PRO core alongside the WiFi stack
+#define SAMPLE_CORE 1
+#define NET_CORE 0
+#define SAMPLE_PRIORITY 3  // above the network task and the Arduino loop task
+#define NET_PRIORITY 2
+#define TASK_STACK 8192  // bytes
+#define NET_TICK_MS 50  // network task polling interval
+#define FRAME_QUEUE_LEN 16  // realtime samples queued for the network task (power of 2): 48 secs
+#define HOUR_QUEUE_LEN 8  // completed hours queued for the history log (power of 2)
+#define DAY_QUEUE_LEN 2  // completed days queued for the 'D' message (power of 2)
+#define DAY_HELD_LEN 4  // days whose ws/day block or 'D' message could not be posted, held for the reconnection
+#define MSG_QUEUE_LEN 8  // text messages queued for ws/messages (power of 2)
 
 // Time constants
 #define SECS_1970_TO_2000 946684800UL
+#define TIME_VALID_2K (8766UL * 86400UL)  // 1/1/2024: earlier times are seconds since boot, the time being unknown
 #define HPD 24 // hours per day
 #define DPM 31  // days per month
 #define MPY 12  // months per year
 #define DPY 365 // days per (non-leap) year
-#define CLOCK_UPD_HR 15
-#define CLOCK_UPD_MIN 30
+
+// Clock discipline (Timebase): background SNTP resyncs, slewed rather than stepped
+#define NTP_SERVER "europe.pool.ntp.org"
+#define CLOCK_SYNC_SECS 3600  // SNTP resync interval
+#define CLOCK_STEP_MS 2000  // larger offsets are stepped
+#define CLOCK_SLEW_PPM 500  // rate at which smaller offsets are slewed away (2 secs take 67 minutes)
+#define CLOCK_DRIFT_MAX_PPM 200  // largest crystal drift correction believed
+#define CLOCK_DRIFT_MIN_SECS 600  // shortest interval between syncs that updates the drift estimate
+#define CLOCK_REBASE_SECS 3600  // the model is rebased at least this often (keeps its products in range)
 
 // Pin numbers == GPIO numbers
 const int RevsPin = 25;  // pin connected to wind speed rotation counter (interrupt 0) 
 const int RainPin = 15; // pin connected to rain gauge - buckets tipped (interrupt 1);
 const int WDPin = 32; // vane (wind direction)
-const int VoltsPin = 34;  // raw analog value, not volts!
+const int VoltsPin = 34;  // battery, through a BATT_DIVIDER divider
 const int LEDPin = 16;
 
 #endif
\ No newline at end of file
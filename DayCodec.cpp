@@ -0,0 +1,134 @@
+#include "DayCodec.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// DayCodec: encoder and decoder for the day block (layout in DayCodec.h)
+
+#define DAY_HEADER_LEN 6
+
+// field(), setField(): column access to a histRec
+static int32_t field(const histRec& r, int col) {
+  switch (col) {
+    case DC_BUCKETS: return r.rw.bucketsHr;
+    case DC_REVS: return r.rw.revsHr;
+    case DC_GUST: return r.rw.gustHr;
+    case DC_MEAN: return r.rw.meanHr;
+    case DC_SD: return r.rw.sdHr;
+    case DC_WD: return r.rw.wdHr;
+    case DC_BATT: return r.batt.mean;
+    case DC_BATT_LO: return r.batt.lo;
+    case DC_BATT_HI: return r.batt.hi;
+  }
+  if (col < DC_SENS_LO) return r.s.mean.v[col - DC_SENS];
+  if (col < DC_SENS_HI) return r.s.lo.v[col - DC_SENS_LO];
+  if (col < DC_BATT) return r.s.hi.v[col - DC_SENS_HI];
+  return r.rw.histHr[col - DC_HIST];
+}
+
+static void setField(histRec* r, int col, int32_t v) {
+  switch (col) {
+    case DC_BUCKETS: r->rw.bucketsHr = v; return;
+    case DC_REVS: r->rw.revsHr = v; return;
+    case DC_GUST: r->rw.gustHr = v; return;
+    case DC_MEAN: r->rw.meanHr = v; return;
+    case DC_SD: r->rw.sdHr = v; return;
+    case DC_WD: r->rw.wdHr = v; return;
+    case DC_BATT: r->batt.mean = v; return;
+    case DC_BATT_LO: r->batt.lo = v; return;
+    case DC_BATT_HI: r->batt.hi = v; return;
+  }
+  if (col < DC_SENS_LO) r->s.mean.v[col - DC_SENS] = v;
+  else if (col < DC_SENS_HI) r->s.lo.v[col - DC_SENS_LO] = v;
+  else if (col < DC_BATT) r->s.hi.v[col - DC_SENS_HI] = v;
+  else r->rw.histHr[col - DC_HIST] = (uint16_t)v;
+}
+
+// putVarint(): zigzag (small magnitudes of either sign -> small numbers), then 7 bits per byte, low first
+static int putVarint(byte* p, int room, int32_t v) {
+  uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+  int n = 0;
+  do {
+    if (n == room) return -1;
+    p[n++] = (byte)((z & 0x7f) | (z > 0x7f ? 0x80 : 0));
+    z >>= 7;
+  } while (z);
+  return n;
+}
+
+static int getVarint(const byte* p, int room, int32_t* v) {
+  uint32_t z = 0;
+  for (int n = 0; n < room && n < 5; n++) {
+    z |= (uint32_t)(p[n] & 0x7f) << (7 * n);
+    if ((p[n] & 0x80) == 0) {
+      *v = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+      return n + 1;
+    }
+  }
+  return -1;
+}
+
+/*********************************************************************************************************
+encodeDay(): packs a day of hourly records into a columnar block
+parameters:
+  d: dayRecs holding the day (only the hours flagged in d.present are used)
+  buf: byte buffer
+  maxLen: size of buf (DAY_BLOCK_MAX is always enough for real data)
+returns: int: block length, 0 if it does not fit
+**********************************************************************************************************/
+int encodeDay(const dayRecs& d, byte* buf, int maxLen) {
+  if (maxLen < DAY_HEADER_LEN + 2) return 0;
+  buf[0] = DAY_MAGIC | DAY_VERSION;
+  buf[1] = (byte)(d.day2k & 0xff);
+  buf[2] = (byte)(d.day2k >> 8);
+  buf[3] = (byte)(d.present & 0xff);
+  buf[4] = (byte)(d.present >> 8);
+  buf[5] = (byte)(d.present >> 16);
+  int len = DAY_HEADER_LEN;
+  for (int col = 0; col < DAY_COLS; col++) {
+    int32_t prev = 0;
+    for (int h = 0; h < HPD; h++) {
+      if ((d.present & (1UL << h)) == 0) continue;
+      int32_t v = field(d.hours[h], col);
+      int n = putVarint(buf + len, maxLen - 2 - len, v - prev);
+      if (n < 0) return 0;
+      len += n;
+      prev = v;
+    }
+  }
+  uint16_t crc = crc16(buf, len);
+  buf[len++] = (byte)(crc & 0xff);
+  buf[len++] = (byte)(crc >> 8);
+  return len;
+}
+
+/*********************************************************************************************************
+decodeDay(): unpacks and checks a day block. Hours not present are zeroed.
+parameters:
+  buf: received bytes
+  len: number of bytes received
+  d: dayRecs to receive the day
+returns: boolean: true if the block has the right header and CRC and decodes exactly
+**********************************************************************************************************/
+bool decodeDay(const byte* buf, int len, dayRecs* d) {
+  if (len < DAY_HEADER_LEN + 2 || buf[0] != (DAY_MAGIC | DAY_VERSION)) return false;
+  if ((uint16_t)(buf[len - 2] | (buf[len - 1] << 8)) != crc16(buf, len - 2)) return false;
+  memset(d, 0, sizeof(dayRecs));
+  d->day2k = buf[1] | (buf[2] << 8);
+  d->present = buf[3] | (buf[4] << 8) | ((uint32_t)buf[5] << 16);
+  int pos = DAY_HEADER_LEN;
+  for (int col = 0; col < DAY_COLS; col++) {
+    int32_t prev = 0;
+    for (int h = 0; h < HPD; h++) {
+      if ((d->present & (1UL << h)) == 0) continue;
+      int32_t delta;
+      int n = getVarint(buf + pos, len - 2 - pos, &delta);
+      if (n < 0) return false;
+      pos += n;
+      prev += delta;
+      setField(&d->hours[h], col, prev);
+    }
+  }
+  for (int h = 0; h < HPD; h++) {
+    if (d->present & (1UL << h)) d->hours[h].hour2k = d->day2k * HPD + h;
+  }
+  return pos == len - 2;
+}
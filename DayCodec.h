@@ -0,0 +1,46 @@
+#ifndef DAYCODEC_H
+#define DAYCODEC_H
+
+#include "Hal.h"
+#include "Config.h"
+#include "HistLog.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// DayCodec: compressed columnar block holding one day of hourly records, posted on ws/day for bulk export.
+// Each field is a column; within a column every present hour is stored as the zigzag varint of its difference
+// from the previous present hour (the first from 0), so slowly changing values (pressure, temperature) and
+// mostly-zero ones (buckets, histogram bands) take one byte per hour. The sensors have three column sets: the
+// hour's mean, minimum and maximum readings, then the battery's.
+// Layout (little-endian):
+//   0     header: DAY_MAGIC | DAY_VERSION
+//   1-2   day: days since 1/1/2000
+//   3-5   hours present: bit h set if hour h is in the block
+//   6-    DAY_COLS columns in dayColumn order, each one varint per present hour
+//   last 2 CRC-16/CCITT of everything before it
+// DayCodec.cpp has no board dependencies, so host tools encode and decode with the same code.
+
+#define DAY_MAGIC 0xD0
+#define DAY_VERSION 3
+
+// Columns, in block order
+enum dayColumn {
+  DC_BUCKETS, DC_REVS, DC_GUST, DC_MEAN, DC_SD, DC_WD,
+  DC_SENS,  // first of SENS_FIELDS sensor mean columns (StationSensors order)
+  DC_SENS_LO = DC_SENS + SENS_FIELDS,  // first of SENS_FIELDS sensor minimum columns
+  DC_SENS_HI = DC_SENS_LO + SENS_FIELDS,  // first of SENS_FIELDS sensor maximum columns
+  DC_BATT = DC_SENS_HI + SENS_FIELDS, DC_BATT_LO, DC_BATT_HI,
+  DC_HIST  // first of WS_HIST_BINS histogram band columns
+};
+#define DAY_COLS (DC_HIST + WS_HIST_BINS)
+
+// Structure holding one day of hourly records
+struct dayRecs {
+  uint32_t day2k;  // days since 1/1/2000
+  uint32_t present;  // bit h set if hours[h] holds hour h
+  histRec hours[HPD];
+};
+
+int encodeDay(const dayRecs& d, byte* buf, int maxLen);
+bool decodeDay(const byte* buf, int len, dayRecs* d);
+
+#endif
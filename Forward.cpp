@@ -0,0 +1,85 @@
+#include "Forward.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Forward class: bounded ring of encoded realtime samples (see Forward.h)
+
+Forward::Forward() : _buf(NULL), _cap(0), _head(0), _count(0), _dropped(0) {};
+
+/*********************************************************************************************************
+begin(): allocates the ring (once) and empties it
+parameters: capacity: int: samples held (FRAME_LEN bytes each)
+returns: boolean: true if the ring could be allocated
+**********************************************************************************************************/
+bool Forward::begin(int capacity) {
+  if (!_buf) {
+    _buf = (byte*)halAllocLarge((unsigned long)capacity * FRAME_LEN);
+    _cap = _buf ? capacity : 0;
+  }
+  _head = 0;
+  _count = 0;
+  _dropped = 0;
+  return _buf != NULL;
+}
+
+/*********************************************************************************************************
+push(): holds a sample at the end of the ring, evicting the oldest one if the ring is full
+parameters: fr: rtFrame holding the sample
+returns: void
+**********************************************************************************************************/
+void Forward::push(const rtFrame& fr) {
+  if (_cap == 0) {
+    _dropped++;
+    return;
+  }
+  if (_count == _cap) {  // full: the oldest sample goes
+    _head = (_head + 1) % _cap;
+    _count--;
+    _dropped++;
+  }
+  encodeFrame(fr, _buf + ((_head + _count) % _cap) * FRAME_LEN);
+  _count++;
+}
+
+/*********************************************************************************************************
+get(): reads a held sample without removing it
+parameters:
+  i: int: 0 for the oldest sample
+  fr: rtFrame* to receive the sample
+returns: boolean: true if there is such a sample and its frame checks out
+**********************************************************************************************************/
+bool Forward::get(int i, rtFrame* fr) {
+  if (i < 0 || i >= _count) return false;
+  return decodeFrame(_buf + ((_head + i) % _cap) * FRAME_LEN, FRAME_LEN, fr);
+}
+
+/*********************************************************************************************************
+redate(): moves the timestamps of held samples taken before the time was known (seconds since boot) to the
+time found later
+parameters:
+  before: uint32_t: timestamps below this are seconds since boot
+  shift: uint32_t: seconds to add to them
+returns: int: number of samples re-dated
+**********************************************************************************************************/
+int Forward::redate(uint32_t before, uint32_t shift) {
+  int n = 0;
+  rtFrame fr;
+  for (int i = 0; i < _count; i++) {
+    byte* p = _buf + ((_head + i) % _cap) * FRAME_LEN;
+    if (!decodeFrame(p, FRAME_LEN, &fr) || fr.time2k >= before) continue;
+    fr.time2k += shift;
+    encodeFrame(fr, p);
+    n++;
+  }
+  return n;
+}
+
+/*********************************************************************************************************
+discard(): removes the oldest samples (once they have been posted)
+parameters: n: int: number of samples
+returns: void
+**********************************************************************************************************/
+void Forward::discard(int n) {
+  if (n > _count) n = _count;
+  _head = (_head + n) % _cap;
+  _count -= n;
+}
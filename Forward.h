@@ -0,0 +1,35 @@
+#ifndef FORWARD_H
+#define FORWARD_H
+
+#include "Hal.h"
+#include "Config.h"
+#include "Telemetry.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Forward: store-and-forward ring of realtime samples held while the broker cannot be reached.
+// Samples are kept encoded as binary frames (FRAME_LEN bytes, CRC included) in one block allocated at begin(),
+// from PSRAM when the board has it. When the ring is full the oldest sample is evicted and counted as dropped.
+// The network side replays the held samples oldest first, a batch at a time (see Station::serviceForward()).
+
+class Forward {
+
+  public:
+  Forward();
+  bool begin(int capacity);
+  void push(const rtFrame& fr);
+  bool get(int i, rtFrame* fr);
+  void discard(int n);
+  int redate(uint32_t before, uint32_t shift);
+  int count() { return _count; }
+  int capacity() { return _cap; }
+  unsigned long dropped() { return _dropped; }
+
+  private:
+  byte* _buf;
+  int _cap;
+  int _head;  // oldest sample
+  int _count;
+  unsigned long _dropped;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef HAL_H
+#define HAL_H
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Hal: thin hardware abstraction layer between the station classes and the board.
+// Two backends implement the functions declared here:
+//   HalEsp32.cpp: the real station (Arduino core for ESP32, PubSubClient) - compiled when ARDUINO is defined
+//   HalLinux.cpp: host build with a virtual clock and scriptable pins, ADC, sensors and MQTT sink
+// RainWind, Sensors, Chrono and Station only talk to the board through these functions.
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+typedef uint8_t byte;
+
+#define ICACHE_RAM_ATTR
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#endif
+
+// Clock: one monotonic microsecond counter (esp_timer on the ESP32): halMillis() and halMicros() are its
+// wrapping 32-bit views, for intervals; dates and timestamps come from Timebase, which disciplines it by SNTP
+uint64_t halMicros64();
+unsigned long halMillis();
+unsigned long halMicros();
+void halDelay(unsigned long ms);
+void halSleepUntil(unsigned long deadlineMs);
+uint32_t halCycles();  // CPU cycle counter (wraps; per core): for timing short sections
+unsigned long halCyclesPerUs();
+
+// Tasks
+bool halStartTask(const char* name, void (*fn)(void*), void* arg, int core, int priority);
+
+// GPIO and interrupts
+void halPinMode(int pin, int mode);
+int halDigitalRead(int pin);
+void halDigitalWrite(int pin, int val);
+void halAttachISR(int pin, void (*isr)(), int mode);
+
+// Pulse counters (ESP32 PCNT): a pin's falling edges counted in hardware, pulses shorter than filterNs ignored;
+// no CPU work per edge. halCounterBegin() returns false if the unit cannot be had (use an ISR instead).
+bool halCounterBegin(int unit, int pin, unsigned long filterNs);
+uint32_t halCounterRead(int unit);  // falling edges since halCounterBegin() (wraps)
+
+// I2C: each call is one bus transaction (burst), no waiting for conversions
+void halI2CBegin(unsigned long hz);
+bool halI2CWrite(byte addr, const byte* data, unsigned int len);
+bool halI2CRead(byte addr, byte* data, unsigned int len);
+bool halI2CWriteRead(byte addr, byte reg, byte* data, unsigned int len);  // register, repeated start, read
+
+// ADC
+// One pin's conversions in one DMA frame, summed where they are read: its first reading and the sum of the
+// others' differences from it, each taken the short way round the 0-4095 circle (a vane crossing north stays
+// continuous; a battery reading never moves that far)
+struct adcSample {
+  uint8_t pin;
+  uint16_t first;  // 0-4095
+  uint16_t count;  // conversions
+  int32_t sum;  // of (reading - first), each in -2048..2047
+};
+int halAnalogRead(int pin);  // single conversion: only while continuous conversions are not running
+bool halAdcStart(const int* pins, int count, unsigned long hz);  // continuous conversions (DMA) in turn
+int halAdcCollect(adcSample* buf, int maxSamples);  // DMA frames completed since the last call, one entry per pin
+inline int adcDiff(int raw, int first) { return ((raw - first + 2048) & 4095) - 2048; }  // short way round
+unsigned long halAdcOverruns();  // conversions lost because they were not collected in time
+int halAdcMillivolts(int raw);  // calibrated pin voltage
+
+// MQTT
+bool halPublish(const char* topic, const char* payload);
+bool halPublish(const char* topic, const byte* payload, unsigned int length);
+void halMqttLoop();
+bool halMqttConnect();  // one connection attempt (connect and subscribe), without waiting or retrying
+bool halMqttConnected();
+bool halNetUp();  // WiFi associated
+
+// SNTP: periodic background synchronisation; each sync is kept as a sample for Timebase::discipline()
+bool halTimeSyncBegin(const char* server, unsigned long intervalSecs);
+bool halTimeSample(uint64_t* monoUs, uint64_t* us2k);  // newest sync since the last call, if any
+
+// File system: directory for stdio files kept across reboots ("" if none)
+const char* halFsRoot();
+
+// Memory: large long-lived blocks (PSRAM if the board has it), never freed
+void* halAllocLarge(unsigned long bytes);
+
+// Miscellaneous
+long halRandom(long howBig);
+void halLog(const char* text);
+
+#endif
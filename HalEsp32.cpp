@@ -0,0 +1,321 @@
+#ifdef ARDUINO
+#include "Config.h"
+#include "Hal.h"
+#include <WiFi.h>
+#include <Wire.h>
+#include <PubSubClient.h>
+#include "esp_timer.h"
+#include "esp_sntp.h"
+#include <LittleFS.h>
+#include "driver/pulse_cnt.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// HalEsp32: ESP32 (Arduino core) backend of the hardware abstraction layer
+// The MQTT client and its connect call live in RoofBB.ino (MQTT libraries require instances in global space)
+
+extern PubSubClient qtClient;
+bool qtConnect();
+
+uint64_t halMicros64() { return (uint64_t)esp_timer_get_time(); }  // IRAM-safe: usable in ISRs
+unsigned long halMillis() { return (unsigned long)(esp_timer_get_time() / 1000LL); }
+unsigned long halMicros() { return (unsigned long)esp_timer_get_time(); }
+void halDelay(unsigned long ms) { delay(ms); }
+uint32_t halCycles() { return ESP.getCycleCount(); }  // CCOUNT: wraps every 17.9 secs at 240 MHz
+unsigned long halCyclesPerUs() { return ESP.getCpuFreqMHz(); }
+
+/*********************************************************************************************************
+halSleepUntil(): blocks the calling task until halMillis() reaches the deadline, letting FreeRTOS run other
+tasks or the idle task (which can light sleep) meanwhile
+parameters: deadlineMs: unsigned long: halMillis() value to wake at
+returns: void
+**********************************************************************************************************/
+void halSleepUntil(unsigned long deadlineMs) {
+  long wait = (long)(deadlineMs - halMillis());
+  if (wait > 0) vTaskDelay(pdMS_TO_TICKS(wait));
+}
+
+/*********************************************************************************************************
+halStartTask(): creates a FreeRTOS task pinned to one core
+parameters:
+  name: task name
+  fn: task body (must never return)
+  arg: passed to fn
+  core: int: 0 (PRO, with WiFi) or 1 (APP)
+  priority: int: FreeRTOS priority
+returns: boolean: true if the task was created
+**********************************************************************************************************/
+bool halStartTask(const char* name, void (*fn)(void*), void* arg, int core, int priority) {
+  return xTaskCreatePinnedToCore(fn, name, TASK_STACK, arg, priority, NULL, core) == pdPASS;
+}
+
+void halPinMode(int pin, int mode) { pinMode(pin, mode); }
+int halDigitalRead(int pin) { return digitalRead(pin); }
+void halDigitalWrite(int pin, int val) { digitalWrite(pin, val); }
+
+/*********************************************************************************************************
+halAttachISR(): attaches an interrupt service routine to a GPIO pin
+parameters:
+  pin: int: GPIO number
+  isr: the routine (must be placed in IRAM with ICACHE_RAM_ATTR)
+  mode: int: RISING, FALLING or CHANGE
+returns: void
+**********************************************************************************************************/
+void halAttachISR(int pin, void (*isr)(), int mode) {
+  attachInterrupt(digitalPinToInterrupt(pin), isr, mode);
+}
+
+// Pulse counters (ESP-IDF PCNT driver): the hardware count is 16-bit, so a watch point at its limit lets the
+// driver accumulate the overflows into the 32-bit count read by halCounterRead()
+#define PCNT_LIMIT 32000
+static pcnt_unit_handle_t _pcnt[PULSE_COUNTERS];
+
+/*********************************************************************************************************
+halCounterBegin(): sets up a PCNT unit counting the falling edges of a pin, behind the glitch filter
+parameters:
+  unit: int: our counter number (0 to PULSE_COUNTERS - 1)
+  pin: int: GPIO number (its pull-up set beforehand)
+  filterNs: unsigned long: pulses shorter than this are ignored (at most about 12700 ns)
+returns: boolean: true if counting, false if no unit could be had
+**********************************************************************************************************/
+bool halCounterBegin(int unit, int pin, unsigned long filterNs) {
+  if (unit < 0 || unit >= PULSE_COUNTERS || _pcnt[unit] != NULL) return false;
+  pcnt_unit_config_t unitCfg = {};
+  unitCfg.low_limit = -1;
+  unitCfg.high_limit = PCNT_LIMIT;
+  unitCfg.flags.accum_count = 1;
+  pcnt_unit_handle_t u = NULL;
+  if (pcnt_new_unit(&unitCfg, &u) != ESP_OK) return false;
+  pcnt_glitch_filter_config_t filterCfg = {};
+  filterCfg.max_glitch_ns = filterNs;
+  pcnt_chan_config_t chanCfg = {};
+  chanCfg.edge_gpio_num = pin;
+  chanCfg.level_gpio_num = -1;
+  pcnt_channel_handle_t chan = NULL;
+  if (pcnt_unit_set_glitch_filter(u, &filterCfg) != ESP_OK || pcnt_new_channel(u, &chanCfg, &chan) != ESP_OK ||
+    pcnt_channel_set_edge_action(chan, PCNT_CHANNEL_EDGE_ACTION_HOLD, PCNT_CHANNEL_EDGE_ACTION_INCREASE) != ESP_OK ||
+    pcnt_unit_add_watch_point(u, PCNT_LIMIT) != ESP_OK || pcnt_unit_enable(u) != ESP_OK ||
+    pcnt_unit_clear_count(u) != ESP_OK || pcnt_unit_start(u) != ESP_OK) {
+    pcnt_unit_disable(u);  // if it got that far
+    if (chan != NULL) pcnt_del_channel(chan);
+    pcnt_del_unit(u);
+    return false;
+  }
+  _pcnt[unit] = u;
+  return true;
+}
+
+uint32_t halCounterRead(int unit) {
+  int count = 0;
+  pcnt_unit_get_count(_pcnt[unit], &count);
+  return (uint32_t)count;
+}
+
+void halI2CBegin(unsigned long hz) {
+  Wire.begin();
+  Wire.setClock(hz);
+}
+
+bool halI2CWrite(byte addr, const byte* data, unsigned int len) {
+  Wire.beginTransmission(addr);
+  Wire.write(data, len);
+  return Wire.endTransmission() == 0;
+}
+
+bool halI2CRead(byte addr, byte* data, unsigned int len) {
+  if (Wire.requestFrom(addr, (size_t)len) != len) return false;
+  return Wire.readBytes(data, len) == len;
+}
+
+bool halI2CWriteRead(byte addr, byte reg, byte* data, unsigned int len) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;  // repeated start
+  return halI2CRead(addr, data, len);
+}
+
+int halAnalogRead(int pin) { return analogRead(pin); }
+
+// Continuous ADC (ESP-IDF driver): the I2S DMA fills a pool of ADC_BUF_BYTES with conversions of the pins in turn
+#define ADC_MAX_PINS 4
+static adc_continuous_handle_t _adcHandle = NULL;
+static adc_cali_handle_t _adcCali = NULL;
+static int _adcPins[ADC_MAX_PINS];
+static adc_channel_t _adcChannels[ADC_MAX_PINS];
+static int _adcPinCount = 0;
+static volatile unsigned long _adcOverruns = 0;
+
+static bool IRAM_ATTR onAdcPoolFull(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata, void* arg) {
+  _adcOverruns += edata->size / SOC_ADC_DIGI_RESULT_BYTES;
+  return false;
+}
+
+/*********************************************************************************************************
+halAdcStart(): starts continuous conversions of ADC1 pins (ADC2 is not usable alongside WiFi), 12 bit at 12 dB
+attenuation, and sets up the eFuse calibration
+parameters:
+  pins: GPIO numbers
+  count: int: number of pins (up to ADC_MAX_PINS)
+  hz: unsigned long: conversions per second, all pins together (20 kHz - 2 MHz)
+returns: boolean: true if the conversions are running (otherwise use halAnalogRead())
+**********************************************************************************************************/
+bool halAdcStart(const int* pins, int count, unsigned long hz) {
+  if (count > ADC_MAX_PINS) return false;
+  adc_digi_pattern_config_t pattern[ADC_MAX_PINS] = {};
+  for (int i = 0; i < count; i++) {
+    adc_unit_t unit;
+    if (adc_continuous_io_to_channel(pins[i], &unit, &_adcChannels[i]) != ESP_OK || unit != ADC_UNIT_1) return false;
+    pattern[i].atten = ADC_ATTEN_DB_12;
+    pattern[i].channel = _adcChannels[i];
+    pattern[i].unit = ADC_UNIT_1;
+    pattern[i].bit_width = ADC_BITWIDTH_12;
+    _adcPins[i] = pins[i];
+  }
+  adc_continuous_handle_cfg_t handleCfg = {};
+  handleCfg.max_store_buf_size = ADC_BUF_BYTES;
+  handleCfg.conv_frame_size = ADC_FRAME_BYTES;
+  if (adc_continuous_new_handle(&handleCfg, &_adcHandle) != ESP_OK) return false;
+  adc_continuous_config_t cfg = {};
+  cfg.pattern_num = count;
+  cfg.adc_pattern = pattern;
+  cfg.sample_freq_hz = hz;
+  cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  adc_continuous_evt_cbs_t cbs = {};
+  cbs.on_pool_ovf = onAdcPoolFull;
+  if (adc_continuous_config(_adcHandle, &cfg) != ESP_OK ||
+    adc_continuous_register_event_callbacks(_adcHandle, &cbs, NULL) != ESP_OK ||
+    adc_continuous_start(_adcHandle) != ESP_OK) {
+    adc_continuous_deinit(_adcHandle);
+    _adcHandle = NULL;
+    return false;
+  }
+  adc_cali_line_fitting_config_t caliCfg = {};
+  caliCfg.unit_id = ADC_UNIT_1;
+  caliCfg.atten = ADC_ATTEN_DB_12;
+  caliCfg.bitwidth = ADC_BITWIDTH_12;
+  if (adc_cali_create_scheme_line_fitting(&caliCfg, &_adcCali) != ESP_OK) _adcCali = NULL;
+  _adcPinCount = count;
+  return true;
+}
+
+/*********************************************************************************************************
+halAdcCollect(): takes completed DMA frames from the pool, without waiting, and sums each frame's conversions
+per pin while they are in cache: the caller gets a few entries per frame instead of a call per conversion
+parameters:
+  buf: receives one entry per pin per frame
+  maxSamples: room in buf (at least the number of pins)
+returns: int: number of entries
+**********************************************************************************************************/
+int halAdcCollect(adcSample* buf, int maxSamples) {
+  if (_adcHandle == NULL) return 0;
+  uint8_t frame[ADC_FRAME_BYTES];
+  int n = 0;
+  while (n + _adcPinCount <= maxSamples) {
+    uint32_t got = 0;
+    if (adc_continuous_read(_adcHandle, frame, ADC_FRAME_BYTES, &got, 0) != ESP_OK) break;
+    adcSample* s = buf + n;
+    for (int p = 0; p < _adcPinCount; p++) {
+      s[p].pin = _adcPins[p];
+      s[p].count = 0;
+      s[p].sum = 0;
+    }
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+      const adc_digi_output_data_t* d = (const adc_digi_output_data_t*)&frame[i];
+      for (int p = 0; p < _adcPinCount; p++) {
+        if (d->type1.channel != _adcChannels[p]) continue;
+        if (s[p].count++ == 0) s[p].first = d->type1.data;
+        else s[p].sum += adcDiff(d->type1.data, s[p].first);
+        break;
+      }
+    }
+    for (int p = 0; p < _adcPinCount; p++) {  // a pin with no conversion in this frame gives no entry
+      if (s[p].count) buf[n++] = s[p];
+    }
+  }
+  return n;
+}
+
+unsigned long halAdcOverruns() { return _adcOverruns; }
+
+int halAdcMillivolts(int raw) {
+  int mv;
+  if (_adcCali == NULL || adc_cali_raw_to_voltage(_adcCali, raw, &mv) != ESP_OK) mv = raw * 3100 / 4095;
+  return mv;
+}
+
+bool halPublish(const char* topic, const char* payload) {
+  return qtClient.publish(topic, payload, false);
+}
+
+bool halPublish(const char* topic, const byte* payload, unsigned int length) {
+  // streamed from the caller's buffer: no copy into the client's packet buffer, whose size no longer limits it
+  if (!qtClient.beginPublish(topic, length, false)) return false;
+  bool ok = qtClient.write(payload, length) == length;
+  return qtClient.endPublish() && ok;
+}
+
+void halMqttLoop() { qtClient.loop(); }
+bool halMqttConnect() { return qtConnect(); }
+bool halMqttConnected() { return qtClient.connected(); }
+bool halNetUp() { return WiFi.status() == WL_CONNECTED; }
+
+// SNTP: lwIP's client syncs in the background; its callback (lwIP task) records each sync with the esp_timer
+// reading at that moment, for Timebase to slew towards. The system time it also sets is not used.
+static portMUX_TYPE _sntpMux = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t _sntpMono, _sntpUs2k;
+static bool _sntpNew = false;
+
+static void onSntpSync(struct timeval* tv) {
+  uint64_t mono = (uint64_t)esp_timer_get_time();
+  uint64_t us2k = (uint64_t)(tv->tv_sec - SECS_1970_TO_2000) * 1000000ULL + tv->tv_usec;
+  portENTER_CRITICAL(&_sntpMux);
+  _sntpMono = mono;
+  _sntpUs2k = us2k;
+  _sntpNew = true;
+  portEXIT_CRITICAL(&_sntpMux);
+}
+
+bool halTimeSyncBegin(const char* server, unsigned long intervalSecs) {
+  sntp_set_time_sync_notification_cb(onSntpSync);
+  sntp_set_sync_interval(intervalSecs * 1000UL);
+  if (esp_sntp_enabled()) sntp_restart();  // already started (boot time): the new interval applies now
+  else configTime(0, 0, server);
+  return true;
+}
+
+bool halTimeSample(uint64_t* monoUs, uint64_t* us2k) {
+  portENTER_CRITICAL(&_sntpMux);
+  bool fresh = _sntpNew;
+  *monoUs = _sntpMono;
+  *us2k = _sntpUs2k;
+  _sntpNew = false;
+  portEXIT_CRITICAL(&_sntpMux);
+  return fresh;
+}
+
+/*********************************************************************************************************
+halFsRoot(): mounts LittleFS (formatting it the first time) so files can be used through stdio
+parameters: none
+returns: const char*: the mount point, or "" if the file system is unusable
+**********************************************************************************************************/
+const char* halFsRoot() {
+  static bool mounted = false;
+  if (!mounted) mounted = LittleFS.begin(true);
+  return mounted ? "/littlefs" : "";
+}
+
+void* halAllocLarge(unsigned long bytes) {
+  if (psramFound()) {
+    void* p = ps_malloc(bytes);
+    if (p) return p;
+  }
+  return malloc(bytes);
+}
+
+long halRandom(long howBig) { return random(howBig); }
+void halLog(const char* text) { Serial.println(text); }
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef ARDUINO
+#include "Config.h"
+#include "HalLinux.h"
+#include <sys/stat.h>
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// HalLinux: host backend of the hardware abstraction layer. Time is virtual and only moves when the host
+// program (or halDelay()) moves it, so runs are deterministic and can go much faster than real time.
+
+// I2C device models: the chips' own, written from their datasheets (not from the drivers in Sensors.cpp), at the
+// addresses the sensors are wired at
+#define MODEL_AHT 0x38  // AHT20
+#define MODEL_BMP 0x77  // BMP085
+#define MODEL_BHA 0x23  // BH1750, ADDR low
+#define MODEL_BHB 0x5c  // BH1750, ADDR high
+
+static unsigned long long _nowUs = 0ULL;
+static int _level[HAL_NUM_PINS];
+static int _analog[HAL_NUM_PINS];
+static int _noise[HAL_NUM_PINS];
+static int _adcPins[HAL_NUM_PINS];
+static int _adcPinCount = 0;
+static unsigned long _adcHz = 0;
+static unsigned long _adcHzOverride = 0;
+static unsigned long long _adcStartUs, _adcTaken;  // conversions collected (or lost) since the start
+static unsigned long _adcOverruns = 0;
+static void (*_isr[HAL_NUM_PINS])();
+static int _isrMode[HAL_NUM_PINS];
+static unsigned long long _changeUs[HAL_NUM_PINS];  // time of each pin's last level change
+static int _counterUnits = PULSE_COUNTERS;
+static int _counterPin[PULSE_COUNTERS];
+static unsigned long _counterFilterNs[PULSE_COUNTERS];
+static uint32_t _counterCount[PULSE_COUNTERS];
+static bool _counterOn[PULSE_COUNTERS];
+static void (*_publishHook)(const char* topic, const byte* payload, unsigned int length) = 0;
+static bool _brokerUp = true;
+static bool _mqttConnected = false;
+static float _ahtTemp = 15.0f, _ahtHum = 50.0f, _bmpPa = 101325.0f;
+static float _luxA = 0.0f, _luxB = 0.0f;
+static char _fsRoot[64] = "roofbb_fs";
+static unsigned long long _refUs2k = 0ULL;
+static long _refPpb = 0;
+static bool _refSet = false, _ntpUp = true;
+static unsigned long long _syncIntervalUs = 0ULL, _nextSyncUs = 0ULL;
+
+// Clock ------------------------------------------------------------------------------------------
+unsigned long halMillis() { return (unsigned long)(_nowUs / 1000ULL); }
+unsigned long halMicros() { return (unsigned long)_nowUs; }
+void halDelay(unsigned long ms) { _nowUs += 1000ULL * ms; }
+
+void halSleepUntil(unsigned long deadlineMs) {
+  long wait = (long)(deadlineMs - halMillis());
+  if (wait > 0) _nowUs += 1000ULL * wait;
+}
+uint32_t halCycles() { return (uint32_t)(_nowUs * HAL_CYCLES_PER_US); }
+unsigned long halCyclesPerUs() { return HAL_CYCLES_PER_US; }
+void halSetMicros(unsigned long long us) { _nowUs = us; }
+void halAdvanceMicros(unsigned long long us) { _nowUs += us; }
+uint64_t halMicros64() { return _nowUs; }
+
+// Tasks: none on the host, the program drives both sides itself through Station::tick()
+bool halStartTask(const char* /*name*/, void (* /*fn*/)(void*), void* /*arg*/, int /*core*/, int /*priority*/) { return false; }
+
+// GPIO and interrupts ----------------------------------------------------------------------------
+void halPinMode(int pin, int mode) {
+  if (mode == INPUT_PULLUP) _level[pin] = HIGH;
+}
+
+int halDigitalRead(int pin) { return _level[pin]; }
+void halDigitalWrite(int pin, int val) { _level[pin] = val; }
+
+void halAttachISR(int pin, void (*isr)(), int mode) {
+  _isr[pin] = isr;
+  _isrMode[pin] = mode;
+}
+
+/*********************************************************************************************************
+halSetPin(): sets a pin level as seen by halDigitalRead() and runs its ISR (if any) when the edge matches
+parameters:
+  pin: int: GPIO number
+  level: int: LOW or HIGH
+returns: void
+**********************************************************************************************************/
+void halSetPin(int pin, int level) {
+  int prev = _level[pin];
+  _level[pin] = level;
+  if (prev == level) return;
+  unsigned long long sinceUs = _nowUs - _changeUs[pin];
+  _changeUs[pin] = _nowUs;
+  for (int u = 0; u < PULSE_COUNTERS; u++) {
+    if (_counterOn[u] && _counterPin[u] == pin && level == LOW && sinceUs * 1000ULL >= _counterFilterNs[u]) {
+      _counterCount[u]++;
+    }
+  }
+  if (_isr[pin] == 0) return;
+  bool rising = (level == HIGH);
+  if ((_isrMode[pin] == CHANGE) || (rising && _isrMode[pin] == RISING) || (!rising && _isrMode[pin] == FALLING)) {
+    _isr[pin]();
+  }
+}
+
+bool halCounterBegin(int unit, int pin, unsigned long filterNs) {
+  if (unit < 0 || unit >= _counterUnits || unit >= PULSE_COUNTERS) return false;
+  _counterPin[unit] = pin;
+  _counterFilterNs[unit] = filterNs;
+  _counterCount[unit] = 0;
+  _counterOn[unit] = true;
+  return true;
+}
+
+uint32_t halCounterRead(int unit) { return _counterCount[unit]; }
+void halSetCounterUnits(int units) { _counterUnits = units; }
+
+// ADC: continuous conversions at the set rate on the virtual clock, held in a pool of the ESP32's size ------
+int halAnalogRead(int pin) { return _analog[pin]; }
+void halSetAnalog(int pin, int raw) { _analog[pin] = raw; }
+void halSetAnalogNoise(int pin, int amplitude) { _noise[pin] = amplitude; }
+void halSetAdcHz(unsigned long hz) { _adcHzOverride = hz; }
+
+bool halAdcStart(const int* pins, int count, unsigned long hz) {
+  for (int i = 0; i < count; i++) _adcPins[i] = pins[i];
+  _adcPinCount = count;
+  _adcHz = _adcHzOverride ? _adcHzOverride : hz;
+  _adcStartUs = _nowUs;
+  _adcTaken = 0;
+  return true;
+}
+
+/*********************************************************************************************************
+halAdcCollect(): hands over the DMA frames completed since the last call, summed per pin as on the ESP32: the
+pins in turn, each reading its halSetAnalog() value plus uniform noise (wrapping round, as a vane does).
+Conversions that overflowed the pool are lost and counted.
+parameters:
+  buf: receives one entry per pin per frame
+  maxSamples: room in buf (at least the number of pins)
+returns: int: number of entries
+**********************************************************************************************************/
+int halAdcCollect(adcSample* buf, int maxSamples) {
+  if (_adcPinCount == 0) return 0;
+  const unsigned long long frame = ADC_FRAME_BYTES / 2;  // conversions per DMA frame
+  unsigned long long done = (_nowUs - _adcStartUs) * _adcHz / 1000000ULL / frame * frame;  // whole frames
+  unsigned long long pool = ADC_BUF_BYTES / 2;
+  if (done - _adcTaken > pool) {
+    _adcOverruns += done - _adcTaken - pool;
+    _adcTaken = done - pool;
+  }
+  int n = 0;
+  while (n + _adcPinCount <= maxSamples && _adcTaken < done) {
+    adcSample* s = buf + n;
+    for (int p = 0; p < _adcPinCount; p++) {
+      s[p].pin = _adcPins[p];
+      s[p].count = 0;
+      s[p].sum = 0;
+    }
+    for (unsigned long long i = 0; i < frame; i++) {
+      int p = _adcTaken++ % _adcPinCount;
+      int raw = _analog[s[p].pin];
+      if (_noise[s[p].pin]) raw += (int)(random() % (2 * _noise[s[p].pin] + 1)) - _noise[s[p].pin];
+      raw &= 4095;
+      if (s[p].count++ == 0) s[p].first = (uint16_t)raw;
+      else s[p].sum += adcDiff(raw, s[p].first);
+    }
+    n += _adcPinCount;
+  }
+  return n;
+}
+
+unsigned long halAdcOverruns() { return _adcOverruns; }
+int halAdcMillivolts(int raw) { return raw * 3100 / 4095; }  // ideal 12 dB attenuation range
+
+// MQTT -------------------------------------------------------------------------------------------
+bool halPublish(const char* topic, const char* payload) {
+  return halPublish(topic, (const byte*)payload, strlen(payload));
+}
+
+bool halPublish(const char* topic, const byte* payload, unsigned int length) {
+  if (!halMqttConnected()) return false;
+  if (_publishHook) _publishHook(topic, payload, length);
+  return true;
+}
+
+void halMqttLoop() {}
+bool halMqttConnect() { return _mqttConnected = _brokerUp; }
+bool halMqttConnected() { return _mqttConnected = _mqttConnected && _brokerUp; }
+bool halNetUp() { return true; }
+void halSetPublishHook(void (*hook)(const char* topic, const byte* payload, unsigned int length)) {
+  _publishHook = hook;
+}
+void halSetBrokerUp(bool up) { _brokerUp = up; }
+
+// SNTP: a sync is due every interval from halTimeSyncBegin(), taken at the first poll after it is due ----
+bool halTimeSyncBegin(const char* /*server*/, unsigned long intervalSecs) {
+  _syncIntervalUs = 1000000ULL * intervalSecs;
+  _nextSyncUs = _nowUs;  // the first sync straight away (once a reference is set)
+  return true;
+}
+
+bool halTimeSample(uint64_t* monoUs, uint64_t* us2k) {
+  if (!_refSet || _syncIntervalUs == 0ULL || !_ntpUp || _nowUs < _nextSyncUs) return false;  // down: retried when up
+  while (_nextSyncUs <= _nowUs) _nextSyncUs += _syncIntervalUs;
+  *monoUs = _nowUs;
+  *us2k = halTrueUs2k();
+  return true;
+}
+
+unsigned long long halTrueUs2k() {
+  return _refUs2k + _nowUs - (unsigned long long)((long long)_nowUs / 1000 * _refPpb / 1000000);
+}
+
+void halSetTimeRef(unsigned long long us2k, long ppb) {
+  _refUs2k = us2k;
+  _refPpb = ppb;
+  _refSet = true;
+}
+
+void halSetNtpUp(bool up) { _ntpUp = up; }
+
+// File system ------------------------------------------------------------------------------------
+const char* halFsRoot() {
+  mkdir(_fsRoot, 0755);
+  return _fsRoot;
+}
+
+void halSetFsRoot(const char* dir) {
+  strncpy(_fsRoot, dir, sizeof(_fsRoot) - 1);
+}
+
+// Memory -----------------------------------------------------------------------------------------------
+void* halAllocLarge(unsigned long bytes) { return malloc(bytes); }
+
+// Miscellaneous ----------------------------------------------------------------------------------
+long halRandom(long howBig) { return howBig > 0 ? rand() % howBig : 0; }
+void halLog(const char* text) { fprintf(stderr, "%s\n", text); }
+
+// I2C sensor values ---------------------------------------------------------------------------
+void halSetAHT(float temperature, float humidity) {
+  _ahtTemp = temperature;
+  _ahtHum = humidity;
+}
+
+void halSetBMP(float pressurePa) { _bmpPa = pressurePa; }
+
+void halSetLux(int addr, float lux) {
+  if (addr == MODEL_BHB) _luxB = lux;
+  else _luxA = lux;
+}
+
+// I2C bus and device models ------------------------------------------------------------------------
+static unsigned long _i2cHz = 100000UL;
+static unsigned long long _ahtTrigUs = 0ULL;
+static byte _bmpCtrl = 0;
+static unsigned long long _bmpConvUs = 0ULL;
+static const uint16_t _bmpEeprom[11] = { 408, (uint16_t)-72, (uint16_t)-14383, 32741, 32757, 23153, 6190, 4, 0x8000,
+  (uint16_t)-8711, 2868 };  // the datasheet's example calibration: AC1-AC6, B1, B2, MB, MC, MD
+
+// bus time of one transaction: address byte plus data bytes, 9 clocks each
+static bool busTime(unsigned int bytes, bool ack) {
+  _nowUs += (1000000ULL * 9 * (bytes + 1)) / _i2cHz;
+  return ack;
+}
+
+static void put16(byte* p, uint16_t v) {
+  p[0] = (byte)(v >> 8);
+  p[1] = (byte)(v & 0xff);
+}
+
+// BMP085 model: a chip with the datasheet's example calibration at the example's temperature, so that its raw
+// temperature is the example's UT = 27898 (15.0 C) and the intermediate values are the example's:
+// B3 = ((4 AC1 + 57) 2^oss + 2) / 4, B4 = 33457. The raw pressure for the set pressure inverts the datasheet's
+// formulas in floating point: p = p1 + (3038 (p1 / 256)^2 / 2^16 - 7357 p1 / 2^16 + 3791) / 16 solved for p1,
+// then UP = B3 + p1 B4 / (2 (50000 >> oss)). The driver's integer algorithm reads 0 to 5 Pa low of it.
+#define BMP_MODEL_UT 27898L
+
+static long bmpRawPressure(int oss) {
+  double a = 3038.0 / 4294967296.0 / 16, b = 1.0 - 7357.0 / 65536.0 / 16, c = 3791.0 / 16 - _bmpPa;
+  double p1 = (-b + sqrt(b * b - 4 * a * c)) / (2 * a);
+  double b3 = floor(((4.0 * 408 + 57) * (1 << oss) + 2) / 4);
+  return lround(b3 + p1 * 33457.0 / (2.0 * (50000 >> oss)));
+}
+
+void halI2CBegin(unsigned long hz) { _i2cHz = hz; }
+
+bool halI2CWrite(byte addr, const byte* data, unsigned int len) {
+  switch (addr) {
+    case MODEL_AHT:
+      if (data[0] == 0xAC) _ahtTrigUs = _nowUs;
+      return busTime(len, true);
+    case MODEL_BMP:
+      if (len == 2 && data[0] == 0xF4) {
+        _bmpCtrl = data[1];
+        _bmpConvUs = _nowUs;
+      }
+      return busTime(len, true);
+    case MODEL_BHA:
+    case MODEL_BHB:
+      return busTime(len, true);
+  }
+  return busTime(0, false);
+}
+
+bool halI2CRead(byte addr, byte* data, unsigned int len) {
+  memset(data, 0, len);
+  switch (addr) {
+    case MODEL_AHT: {
+      bool busy = _nowUs - _ahtTrigUs < 80000ULL;
+      unsigned long rawH = (unsigned long)(_ahtHum / 100.0f * 1048576.0f);
+      unsigned long rawT = (unsigned long)((_ahtTemp + 50.0f) / 200.0f * 1048576.0f);
+      byte d[6] = { (byte)(0x08 | (busy ? 0x80 : 0)), (byte)(rawH >> 12), (byte)(rawH >> 4),
+        (byte)(((rawH & 0x0f) << 4) | (rawT >> 16)), (byte)(rawT >> 8), (byte)rawT };
+      memcpy(data, d, len < 6 ? len : 6);
+      return busTime(len, true);
+    }
+    case MODEL_BHA:
+    case MODEL_BHB: {
+      float lux = (addr == MODEL_BHB) ? _luxB : _luxA;
+      if (lux < 0) return busTime(0, false);
+      if (len >= 2) put16(data, (uint16_t)(lux * 1.2f));
+      return busTime(len, true);
+    }
+  }
+  return busTime(0, false);
+}
+
+bool halI2CWriteRead(byte addr, byte reg, byte* data, unsigned int len) {
+  memset(data, 0, len);
+  if (addr != MODEL_BMP) return busTime(0, false);
+  busTime(1, true);
+  if (reg == 0xD0) {
+    data[0] = 0x55;
+  }
+  else if (reg == 0xAA) {
+    for (unsigned int i = 0; i < 11 && 2 * i + 1 < len; i++) put16(data + 2 * i, _bmpEeprom[i]);
+  }
+  else if (reg == 0xF6 && _bmpCtrl == 0x2E) {
+    if (_nowUs - _bmpConvUs >= 4500ULL) put16(data, (uint16_t)BMP_MODEL_UT);
+  }
+  else if (reg == 0xF6) {
+    int oss = _bmpCtrl >> 6;
+    long up = bmpRawPressure(oss) << (8 - oss);
+    if (_nowUs - _bmpConvUs >= 1000ULL * (2 + (3 << oss)) && len >= 3) {
+      data[0] = (byte)(up >> 16);
+      data[1] = (byte)(up >> 8);
+      data[2] = (byte)up;
+    }
+  }
+  return busTime(len, true);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef HAL_LINUX_H
+#define HAL_LINUX_H
+
+#ifndef ARDUINO
+#include "Hal.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// HalLinux: controls for the host backend of the HAL. The host program (simulator, benchmark, tool)
+// drives the virtual clock, pin levels, ADC values and sensor readings, and receives MQTT publications.
+
+#define HAL_NUM_PINS 40
+#define HAL_CYCLES_PER_US 240  // halCycles() follows the virtual clock at the ESP32's 240 MHz
+
+// Virtual clock (microseconds since "power on"): halDelay() advances it too
+void halSetMicros(unsigned long long us);
+void halAdvanceMicros(unsigned long long us);
+
+// Pins: setting a level fires the attached ISR when the edge matches its mode, and counts a falling edge on a
+// pulse counter's pin unless it came within the counter's filter time of the pin's previous change
+void halSetPin(int pin, int level);
+void halSetCounterUnits(int units);  // counter units halCounterBegin() can have (default PULSE_COUNTERS; 0: none)
+void halSetAnalog(int pin, int raw);  // ADC reading (0-4095), for single and continuous conversions
+void halSetAnalogNoise(int pin, int amplitude);  // continuous conversions vary by up to +/- amplitude
+void halSetAdcHz(unsigned long hz);  // continuous conversion rate used instead of the one asked (0: as asked),
+                                     // for long runs: call before Station::begin()
+
+// MQTT: every halPublish() while connected is handed to the hook (if any); halMqttConnect() succeeds while
+// the broker is up, and taking the broker down drops the connection
+void halSetPublishHook(void (*hook)(const char* topic, const byte* payload, unsigned int length));
+void halSetBrokerUp(bool up);
+
+// SNTP: the true time, against which halTimeSample() syncs every interval once halTimeSyncBegin() is called:
+// us2k at virtual time zero, with the crystal (the virtual clock) running ppb parts per billion fast
+void halSetTimeRef(unsigned long long us2k, long ppb);
+unsigned long long halTrueUs2k();  // the true time now (meaningful once a reference is set)
+void halSetNtpUp(bool up);  // server reachable (a sync due meanwhile is made once it is back)
+
+// File system: halFsRoot() returns this directory (default "roofbb_fs", created if missing)
+void halSetFsRoot(const char* dir);
+
+// I2C sensors: values returned by the device models behind halI2C...() (AHT20, BMP085, two BH1750); each
+// transaction advances the virtual clock by its time on the bus; a negative lux makes the BH1750 read fail
+void halSetAHT(float temperature, float humidity);
+void halSetBMP(float pressurePa);
+void halSetLux(int addr, float lux);
+
+#endif
+#endif
@@ -0,0 +1,173 @@
+#include "HistLog.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// HistLog class: wear-levelled, crash-safe append-only hourly record log (see HistLog.h)
+
+#define HIST_MAGIC 0x484dU  // "HL" + 1: second record layout (hourly sensor and battery statistics)
+#define HIST_COMMIT 0xc0deU
+#define HIST_SLOT_LEN (2 + 4 + sizeof(histRec) + 2 + 2)
+
+HistLog::HistLog() {};
+
+/*********************************************************************************************************
+begin(): scans the segments, rebuilds the RAM index and finds where the next record goes.
+Recovery after a power cut needs nothing more: the first slot without a valid commit marker ends a segment.
+parameters: root: const char*: directory holding the segment files (from halFsRoot())
+returns: boolean: true if the log is usable
+**********************************************************************************************************/
+bool HistLog::begin(const char* root) {
+  strncpy(_root, root, HIST_PATH_LEN - 12);
+  _root[HIST_PATH_LEN - 12] = '\0';
+  _ok = (root[0] != '\0');
+  _seg = 0;
+  _slot = 0;
+  _seq = 0;
+  _records = 0;
+  for (int i = 0; i < HIST_INDEX_LEN; i++) _index[i].valid = false;
+  if (!_ok) return false;
+
+  char path[HIST_PATH_LEN];
+  histRec rec;
+  uint32_t seq;
+  bool any = false;
+  for (int seg = 0; seg < HIST_SEGMENTS; seg++) {
+    segPath(seg, path);
+    FILE* f = fopen(path, "rb");
+    if (!f) continue;
+    int slot;
+    for (slot = 0; slot < HIST_SEG_RECORDS; slot++) {
+      if (!readSlot(f, slot, &rec, &seq)) break;
+      index(rec, seq, seg, slot);  // segments are scanned in file order, not age: index() keeps the newest
+      if (!any || seq >= _seq) {  // newest record so far: append after it
+        any = true;
+        _seq = seq + 1;
+        _seg = seg;
+        _slot = slot + 1;
+      }
+    }
+    fclose(f);
+  }
+  return true;
+}
+
+/*********************************************************************************************************
+append(): adds a record at the end of the log: one slot write, the commit marker last
+parameters: rec: histRec to store
+returns: boolean: true if the record was committed
+**********************************************************************************************************/
+bool HistLog::append(const histRec& rec) {
+  if (!_ok) return false;
+  char path[HIST_PATH_LEN];
+  if (_slot >= HIST_SEG_RECORDS) {  // newest segment full: erase and reuse the oldest one
+    _seg = (_seg + 1) % HIST_SEGMENTS;
+    _slot = 0;
+    segPath(_seg, path);
+    FILE* f = fopen(path, "wb");
+    if (f) fclose(f);
+    for (int i = 0; i < HIST_INDEX_LEN; i++) {
+      if (_index[i].valid && (_index[i].pos / HIST_SEG_RECORDS == _seg)) {
+        _index[i].valid = false;
+        _records--;
+      }
+    }
+  }
+  segPath(_seg, path);
+  FILE* f = fopen(path, "r+b");
+  if (!f) f = fopen(path, "w+b");
+  if (!f) return false;
+
+  byte slot[HIST_SLOT_LEN];
+  uint16_t magic = HIST_MAGIC, commit = HIST_COMMIT;
+  memcpy(slot, &magic, 2);
+  memcpy(slot + 2, &_seq, 4);
+  memcpy(slot + 6, &rec, sizeof(histRec));
+  uint16_t crc = crc16(slot, 6 + sizeof(histRec));
+  memcpy(slot + 6 + sizeof(histRec), &crc, 2);
+  bool ok = (fseek(f, (long)_slot * HIST_SLOT_LEN, SEEK_SET) == 0)
+    && (fwrite(slot, 1, HIST_SLOT_LEN - 2, f) == HIST_SLOT_LEN - 2)
+    && (fflush(f) == 0)
+    && (fwrite(&commit, 1, 2, f) == 2);
+  ok = (fclose(f) == 0) && ok;
+  if (!ok) return false;
+
+  index(rec, _seq, _seg, _slot);
+  _slot++;
+  _seq++;
+  return true;
+}
+
+/*********************************************************************************************************
+find(): looks up the record for an hour
+parameters:
+  hour2k: uint32_t: hours since 1/1/2000
+  rec: histRec* to receive the record
+returns: boolean: true if the hour is in the log
+**********************************************************************************************************/
+bool HistLog::find(uint32_t hour2k, histRec* rec) {
+  histIx& ix = _index[hour2k % HIST_INDEX_LEN];
+  if (!_ok || !ix.valid || ix.hour2k != hour2k) return false;
+  char path[HIST_PATH_LEN];
+  segPath(ix.pos / HIST_SEG_RECORDS, path);
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  uint32_t seq;
+  bool ok = readSlot(f, ix.pos % HIST_SEG_RECORDS, rec, &seq) && (rec->hour2k == hour2k);
+  fclose(f);
+  return ok;
+}
+
+/*********************************************************************************************************
+readSlot(): reads and checks one slot of a segment file
+parameters:
+  f: FILE*: open segment file
+  slot: int: slot number
+  rec: histRec* to receive the record
+  seq: uint32_t* to receive the record's sequence number
+returns: boolean: true if the slot holds a complete, committed record
+**********************************************************************************************************/
+bool HistLog::readSlot(FILE* f, int slot, histRec* rec, uint32_t* seq) {
+  byte buf[HIST_SLOT_LEN];
+  if (fseek(f, (long)slot * HIST_SLOT_LEN, SEEK_SET) != 0) return false;
+  if (fread(buf, 1, HIST_SLOT_LEN, f) != HIST_SLOT_LEN) return false;
+  uint16_t magic, crc, commit;
+  memcpy(&magic, buf, 2);
+  memcpy(&crc, buf + 6 + sizeof(histRec), 2);
+  memcpy(&commit, buf + HIST_SLOT_LEN - 2, 2);
+  if (magic != HIST_MAGIC || commit != HIST_COMMIT || crc != crc16(buf, 6 + sizeof(histRec))) return false;
+  memcpy(seq, buf + 2, 4);
+  memcpy(rec, buf + 6, sizeof(histRec));
+  return true;
+}
+
+/*********************************************************************************************************
+index(): points the RAM index entry for a record's hour at its slot, unless the entry already holds a newer
+record (higher sequence number): the same hour logged again later, or a later hour sharing the entry
+parameters:
+  rec: histRec just written or read
+  seq: uint32_t: its sequence number
+  seg: int: segment number
+  slot: int: slot number
+returns: void
+**********************************************************************************************************/
+void HistLog::index(const histRec& rec, uint32_t seq, int seg, int slot) {
+  histIx& ix = _index[rec.hour2k % HIST_INDEX_LEN];
+  if (ix.valid && (int32_t)(seq - ix.seq) < 0) return;
+  if (!ix.valid) _records++;
+  ix.hour2k = rec.hour2k;
+  ix.seq = seq;
+  ix.pos = (uint16_t)(seg * HIST_SEG_RECORDS + slot);
+  ix.valid = true;
+}
+
+/*********************************************************************************************************
+segPath(): builds the file name of a segment
+parameters:
+  seg: int: segment number
+  buf: char* to receive the path: length HIST_PATH_LEN
+returns: void
+**********************************************************************************************************/
+void HistLog::segPath(int seg, char* buf) {
+  if (snprintf(buf, HIST_PATH_LEN, "%s/hist%d.log", _root, seg) >= HIST_PATH_LEN) {
+    buf[0] = '\0';  // no such file: cannot happen, begin() leaves room after the root
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef HISTLOG_H
+#define HISTLOG_H
+
+#include "Hal.h"
+#include "Config.h"
+#include "RainWind.h"
+#include "Sensors.h"
+#include "Telemetry.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// HistLog: append-only log of hourly records kept in flash, so the Shed's catch-up requests survive a reboot.
+// The log is HIST_SEGMENTS fixed-size segment files used round robin: appends go to the newest segment and,
+// when it is full, the oldest segment is erased and reused, spreading writes evenly over the flash.
+// Each record sits in a fixed-size slot: [magic][sequence][record][CRC][commit marker]. The commit marker is
+// written (and flushed) last, so a record torn by a power cut is ignored and its slot reused on the next boot.
+// A RAM index, direct-mapped on the record's hour, finds any hour still in the log with one read. An hour logged
+// more than once is found at its newest record: the one with the highest sequence number, wherever it sits.
+// Files are accessed through stdio: LittleFS (mounted by halFsRoot()) on the ESP32, a directory on Linux.
+
+// Structure holding one hour's battery statistics (centivolts)
+struct battHr {
+  int mean;
+  int lo;
+  int hi;
+};
+
+// Structure holding one hour's results as logged
+struct histRec {
+  uint32_t hour2k;  // hours since 1/1/2000 (start of the hour)
+  wrHr rw;
+  sensHr s;
+  battHr batt;
+};
+
+// Structure of one RAM index entry
+struct histIx {
+  uint32_t hour2k;
+  uint32_t seq;  // the record's sequence number
+  uint16_t pos;  // segment * HIST_SEG_RECORDS + slot
+  bool valid;
+};
+
+class HistLog {
+
+  public:
+  HistLog();
+  bool begin(const char* root);
+  bool append(const histRec& rec);
+  bool find(uint32_t hour2k, histRec* rec);
+  unsigned long records() { return _records; }  // hours that find() can return
+
+  private:
+  bool readSlot(FILE* f, int slot, histRec* rec, uint32_t* seq);
+  void segPath(int seg, char* buf);
+  void index(const histRec& rec, uint32_t seq, int seg, int slot);
+
+  char _root[HIST_PATH_LEN];
+  bool _ok;
+  int _seg;  // segment being appended to
+  int _slot;  // next free slot in it
+  uint32_t _seq;  // sequence number of the next record
+  unsigned long _records;  // valid index entries
+  histIx _index[HIST_INDEX_LEN];
+};
+
+#endif
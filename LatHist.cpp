@@ -0,0 +1,61 @@
+#include "LatHist.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// LatHist class: logarithmic latency histogram (see LatHist.h)
+
+LatHist::LatHist() {
+  clear();
+}
+
+void LatHist::clear() {
+  memset(_counts, 0, sizeof(_counts));
+  _count = 0;
+  _max = 0;
+}
+
+/*********************************************************************************************************
+upper(): largest value that falls in a bucket
+parameters: b: int: bucket index
+returns: uint32_t: the bucket's upper bound (cycles)
+**********************************************************************************************************/
+uint32_t LatHist::upper(int b) {
+  if (b < (1 << LH_SUB_BITS)) return (uint32_t)b;
+  int msb = (b >> LH_SUB_BITS) + LH_SUB_BITS - 1;
+  uint64_t width = 1ULL << (msb - LH_SUB_BITS);
+  uint64_t lower = (1ULL << msb) + (uint64_t)(b & ((1 << LH_SUB_BITS) - 1)) * width;
+  return (uint32_t)(lower + width - 1);
+}
+
+/*********************************************************************************************************
+percentile(): value below which pct% of the recorded values fall (upper bound of its bucket, capped at max)
+parameters: pct: int: 0-100
+returns: uint32_t: cycles (0 if nothing recorded)
+**********************************************************************************************************/
+uint32_t LatHist::percentile(int pct) {
+  if (_count == 0) return 0;
+  uint32_t rank = (uint32_t)(((uint64_t)_count * pct + 99) / 100);  // ceiling: the rank-th smallest value
+  if (rank == 0) rank = 1;
+  uint32_t seen = 0;
+  for (int b = 0; b < LH_BUCKETS; b++) {
+    seen += _counts[b];
+    if (seen >= rank) return upper(b) < _max ? upper(b) : _max;
+  }
+  return _max;
+}
+
+/*********************************************************************************************************
+summary(): fills a ws/stats record: count, p50, p99 and max in microseconds
+parameters:
+  name: const char*: histogram name (truncated to STAT_NAME_LEN - 1)
+  rec: statRec* to fill
+returns: void
+**********************************************************************************************************/
+void LatHist::summary(const char* name, statRec* rec) {
+  unsigned long cpu = halCyclesPerUs();
+  strncpy(rec->name, name, STAT_NAME_LEN - 1);
+  rec->name[STAT_NAME_LEN - 1] = '\0';
+  rec->count = _count;
+  rec->p50 = percentile(50) / cpu;
+  rec->p99 = percentile(99) / cpu;
+  rec->max = _max / cpu;
+}
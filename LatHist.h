@@ -0,0 +1,54 @@
+#ifndef LATHIST_H
+#define LATHIST_H
+
+#include "Hal.h"
+#include "Config.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// LatHist: fixed-bucket logarithmic latency histogram, in CPU cycles (halCycles()).
+// Each power of two is split into 2^LH_SUB_BITS buckets, so a bucket is at most 25% wide and a percentile read
+// from it is within 25% (always on the high side: the bucket's upper bound is reported). Recording is a few
+// shifts and one increment: no division, no floating point, no search.
+// Percentiles are reported in microseconds through statRec, the record queued for ws/stats.
+
+#define LH_SUB_BITS 2
+#define LH_BUCKETS ((32 - LH_SUB_BITS + 1) << LH_SUB_BITS)  // covers every uint32_t
+
+// Structure holding one histogram's summary for ws/stats (times in microseconds)
+struct statRec {
+  char name[STAT_NAME_LEN];
+  uint32_t count;
+  uint32_t p50;
+  uint32_t p99;
+  uint32_t max;
+};
+
+class LatHist {
+
+  public:
+  LatHist();
+  void clear();
+  void record(uint32_t cycles) {
+    _counts[bucket(cycles)]++;
+    _count++;
+    if (cycles > _max) _max = cycles;
+  }
+  uint32_t count() { return _count; }
+  uint32_t percentile(int pct);
+  uint32_t max() { return _max; }
+  void summary(const char* name, statRec* rec);
+
+  private:
+  static int bucket(uint32_t v) {
+    if (v < (1UL << LH_SUB_BITS)) return (int)v;
+    int msb = 31 - __builtin_clz(v);
+    return ((msb - LH_SUB_BITS + 1) << LH_SUB_BITS) + (int)((v >> (msb - LH_SUB_BITS)) & ((1UL << LH_SUB_BITS) - 1));
+  }
+  static uint32_t upper(int b);
+
+  uint32_t _counts[LH_BUCKETS];
+  uint32_t _count;
+  uint32_t _max;
+};
+
+#endif
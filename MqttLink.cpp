@@ -0,0 +1,116 @@
+#include "MqttLink.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// MqttLink: MQTT connection state machine (see MqttLink.h). The client itself is reached through the HAL.
+
+MqttLink::MqttLink() {};
+
+/*********************************************************************************************************
+begin(): starts the link down (idle), as at boot
+parameters: none
+returns: void
+**********************************************************************************************************/
+void MqttLink::begin() {
+  memset(&_stats, 0, sizeof(_stats));
+  _state = MQ_IDLE;
+  _failures = 0;
+  _downSince = halMillis();
+  _retryAt = _downSince;
+  _bJustConnected = false;
+}
+
+/*********************************************************************************************************
+step(): advances the state machine by one step: at most one connection attempt, no waiting
+parameters: none
+returns: int: the state after the step
+**********************************************************************************************************/
+int MqttLink::step() {
+  unsigned long now = halMillis();
+  switch (_state) {
+    case MQ_IDLE:
+      if (halNetUp()) enter(MQ_CONNECTING);
+      break;
+    case MQ_CONNECTED:
+      if (!halMqttConnected()) {
+        _stats.drops++;
+        _downSince = now;
+        enter(halNetUp() ? MQ_CONNECTING : MQ_IDLE);
+      }
+      break;
+    case MQ_BACKOFF:
+      if ((long)(now - _retryAt) >= 0) enter(halNetUp() ? MQ_CONNECTING : MQ_IDLE);
+      break;
+  }
+  if (_state != MQ_CONNECTING) return _state;
+
+  // The one connection attempt of this step
+  _stats.attempts++;
+  if (halMqttConnect()) {
+    unsigned long down = now - _downSince;
+    _stats.lastDownMs = down;
+    if (down > _stats.maxDownMs) _stats.maxDownMs = down;
+    _stats.totalDownMs += down;
+    _failures = 0;
+    _bJustConnected = true;
+    enter(MQ_CONNECTED);
+  }
+  else {
+    _stats.failures++;
+    _failures++;
+    _retryAt = now + backoffMs();
+    enter(MQ_BACKOFF);
+  }
+  return _state;
+}
+
+/*********************************************************************************************************
+justConnected(): reports a new connection, once
+parameters: none
+returns: boolean: true on the first call after the link came up
+**********************************************************************************************************/
+bool MqttLink::justConnected() {
+  bool b = _bJustConnected;
+  _bJustConnected = false;
+  return b;
+}
+
+/*********************************************************************************************************
+stateName(): name of a state, for messages
+parameters: state: int: MQ_ state
+returns: const char*: the name
+**********************************************************************************************************/
+const char* MqttLink::stateName(int state) {
+  switch (state) {
+    case MQ_IDLE: return "idle";
+    case MQ_CONNECTING: return "connecting";
+    case MQ_CONNECTED: return "connected";
+    case MQ_BACKOFF: return "backoff";
+  }
+  return "?";
+}
+
+/*********************************************************************************************************
+enter(): changes state and logs the transition
+parameters: state: int: new MQ_ state
+returns: void
+**********************************************************************************************************/
+void MqttLink::enter(int state) {
+  char mBuf[BUF_LEN];
+  sprintf(mBuf, "MQTT %s -> %s", stateName(_state), stateName(state));
+  halLog(mBuf);
+  _state = state;
+  _stats.transitions++;
+}
+
+/*********************************************************************************************************
+backoffMs(): wait before the next attempt: the exponential backoff for the failures so far, of which the
+second half is random ("equal jitter")
+parameters: none
+returns: unsigned long: milliseconds
+**********************************************************************************************************/
+unsigned long MqttLink::backoffMs() {
+  unsigned long base = MQTT_BACKOFF_MIN_MS;
+  for (int i = 1; i < _failures && base < MQTT_BACKOFF_MAX_MS; i++) base *= 2;
+  if (base > MQTT_BACKOFF_MAX_MS) base = MQTT_BACKOFF_MAX_MS;
+  return base / 2 + (unsigned long)halRandom((long)(base / 2) + 1);
+}
@@ -0,0 +1,52 @@
+#ifndef MQTTLINK_H
+#define MQTTLINK_H
+
+#include "Hal.h"
+#include "Config.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// MqttLink: non-blocking state machine for the MQTT broker connection, stepped once per network tick.
+//   MQ_IDLE: no WiFi            MQ_CONNECTING: one connection attempt on the next step
+//   MQ_CONNECTED: up            MQ_BACKOFF: waiting before the next attempt
+// A step makes at most one connection attempt (halMqttConnect()) and never waits: after a failure the next
+// attempt is due after an exponential backoff (MQTT_BACKOFF_MIN_MS doubling up to MQTT_BACKOFF_MAX_MS) with
+// jitter, so a station and its neighbours do not retry in lockstep after a broker restart.
+
+enum { MQ_IDLE, MQ_CONNECTING, MQ_CONNECTED, MQ_BACKOFF };
+
+// Structure holding the connection metrics
+struct mqttStats {
+  unsigned long transitions;  // state changes
+  unsigned long attempts;  // connection attempts
+  unsigned long failures;  // failed attempts
+  unsigned long drops;  // connections lost
+  unsigned long lastDownMs;  // time to reconnect: loss (or boot) to connection, last outage
+  unsigned long maxDownMs;  // longest outage
+  unsigned long totalDownMs;  // sum of all outages
+};
+
+class MqttLink {
+
+  public:
+  MqttLink();
+  void begin();
+  int step();
+  int state() { return _state; }
+  bool connected() { return _state == MQ_CONNECTED; }
+  bool justConnected();
+  const mqttStats& stats() { return _stats; }
+  static const char* stateName(int state);
+
+  private:
+  void enter(int state);
+  unsigned long backoffMs();
+
+  int _state;
+  int _failures;  // consecutive failed attempts
+  unsigned long _downSince;  // halMillis() when the connection was lost
+  unsigned long _retryAt;  // halMillis() when the backoff ends
+  bool _bJustConnected;
+  mqttStats _stats;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef MSGWRITER_H
+#define MSGWRITER_H
+
+#include "Hal.h"
+#include "Config.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// MsgWriter: fixed-capacity, append-only writer that builds an MQTT message in one pass, in the buffer it is
+// published from: integers are formatted by hand (no sprintf), the length is kept as it grows (no strlen).
+// The CSV fields of the 'R', 'H', 'K', 'B' and 'D' messages are declared once, as layouts shared by RainWind,
+// Sensors, Telemetry and Station: below, and the sensors' from their drivers (Sensors.h). csvLen() gives a
+// layout's longest possible text at compile time, so each message's worst case is checked against its buffer
+// with static_assert; at run time a value with more digits than its field allows is written as the field's
+// largest value (all 9s), so the compile-time bound always holds.
+
+// Structure describing one CSV field (written after a comma)
+struct csvField {
+  uint8_t width;  // minimum characters, zero padded like %0Nd (the sign counts)
+  uint8_t digits;  // most digits
+  bool sign;  // may be negative
+};
+
+template <int N> constexpr int csvLen(const csvField (&layout)[N]) {
+  int len = 0;
+  for (int i = 0; i < N; i++) {
+    int chars = layout[i].digits + (layout[i].sign ? 1 : 0);
+    len += 1 + (chars > layout[i].width ? chars : layout[i].width);
+  }
+  return len;
+}
+
+// Message layouts
+constexpr csvField CSV_RW_RT[] = {  // buckets, revs3, maxRevs, wd (raw 0-4095 in CSV version 1)
+  { 4, 5, false }, { 4, 5, false }, { 4, 5, false }, { 4, 4, false } };
+constexpr csvField CSV_RW_HR[] = {  // bucketsHr, revsHr, gustHr, wdHr
+  { 4, 5, false }, { 4, 6, false }, { 4, 5, false }, { 4, 3, false } };
+constexpr csvField CSV_BATT[] = {  // battery (centivolts; raw in CSV version 1)
+  { 2, 4, false } };
+constexpr csvField CSV_DAY[] = {  // hours, buckets, bucketsHi
+  { 2, 2, false }, { 4, 5, false }, { 4, 5, false } };
+
+constexpr int ULONG_LEN = 10;  // decimal digits of a 32-bit unsigned
+
+class MsgWriter {
+
+  public:
+  MsgWriter(char* buf, int capacity) : _buf(buf), _cap(capacity), _len(0), _full(false) {}
+
+  void put(char c) {
+    if (_len < _cap - 1) _buf[_len++] = c;
+    else _full = true;
+  }
+
+  void putStr(const char* s) {
+    while (*s) put(*s++);
+  }
+
+  void putUInt(uint32_t v) {
+    putDigits(v, false, 0, ULONG_LEN);
+  }
+
+  /*********************************************************************************************************
+  putInt(): writes an integer, zero padded to width like %0Nd, saturated to the given number of digits
+  parameters:
+    v: long: value
+    width: int: minimum characters (the sign counts)
+    digits: int: most digits (values beyond are written as 99...9 or -99...9)
+  returns: void
+  **********************************************************************************************************/
+  void putInt(long v, int width, int digits) {
+    bool neg = v < 0;
+    putDigits(neg ? (uint32_t)(-(v + 1)) + 1 : (uint32_t)v, neg, width, digits);
+  }
+
+  template <int N, typename T> void putCSV(const csvField (&layout)[N], const T (&vals)[N]) {
+    for (int i = 0; i < N; i++) {
+      put(',');
+      putInt(layout[i].sign || vals[i] >= 0 ? vals[i] : 0, layout[i].width, layout[i].digits);
+    }
+  }
+
+  const char* text() {
+    _buf[_len] = '\0';
+    return _buf;
+  }
+  const byte* bytes() { return (const byte*)_buf; }
+  int length() { return _len; }
+  bool full() { return _full; }
+
+  private:
+  void putDigits(uint32_t u, bool neg, int width, int digits) {
+    char tmp[ULONG_LEN];
+    if (digits < ULONG_LEN) {
+      uint32_t most = 0;
+      for (int i = 0; i < digits; i++) most = most * 10 + 9;
+      if (u > most) u = most;
+    }
+    int n = 0;
+    do {
+      tmp[n++] = (char)('0' + u % 10);
+      u /= 10;
+    } while (u);
+    if (neg) put('-');
+    for (int pad = width - n - (neg ? 1 : 0); pad > 0; pad--) put('0');
+    while (n) put(tmp[--n]);
+  }
+
+  char* _buf;
+  int _cap;
+  int _len;
+  bool _full;
+};
+
+#endif
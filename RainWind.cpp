@@ -1,45 +1,41 @@
 #include "Config.h"
-#include "Arduino.h"
+#include "Hal.h"
 #include "RainWind.h"
+#include "SpscRing.h"
 
-// ------------------------------ Version of 12/10/2024 ---------------------------------
+// ------------------------------ Version of 17/10/2026 ---------------------------------
 
 // Interrupt Service Routines start here______________
 
 // Rain
 
-volatile unsigned long _lastRTime  = 0;
+volatile uint32_t _lastRTime  = 0;
 volatile int _cumTipsCount;
 volatile int _hrTipsCount; // number of rain bucket tips (cumulative per hour)
-const int _margin = 5;  // minimum milliseconds between checks: insurance against contact bounce: ?? STILL NEEDED FOR HALL EFFECT SENSORS???  
 
 void ICACHE_RAM_ATTR buckets_tipped();
 void buckets_tipped() {
-unsigned long thisRTime = millis();
-  if (thisRTime - _lastRTime > _margin) {
+  uint32_t thisRTime = (uint32_t)halMicros();  // same counter as the anemometer's pulses and the Timebase
+  if (thisRTime - _lastRTime > PULSE_MARGIN_US) {
     _cumTipsCount++;
     _hrTipsCount++;
     _lastRTime = thisRTime;
   }
 }
 
-// Wind 
-volatile int _gustCounter = 0;
-volatile int _currRevs = 0;
-volatile int _prevRevs = 0;
-volatile unsigned long _lastSTime = 0;
-volatile unsigned long _thisSTime;
+// Wind: each rotation's timestamp (microseconds) goes into a lock-free ring drained by updateRevs()
+SpscRing<uint32_t, PULSE_RING_LEN> _pulses;
+volatile uint32_t _lastSTime = 0;
 
 void ICACHE_RAM_ATTR one_Rotation();
 void one_Rotation() {
-  _thisSTime = millis();
-  if (_thisSTime - _lastSTime > _margin) {
-    if (digitalRead(RevsPin) == LOW)
+  uint32_t thisSTime = (uint32_t)halMicros();
+  if (thisSTime - _lastSTime > PULSE_MARGIN_US) {
+    if (halDigitalRead(RevsPin) == LOW)
     {
-       _currRevs++;
-       _gustCounter++;
+       _pulses.push(thisSTime);  // full ring: pulse dropped and counted
     }
-    _lastSTime = _thisSTime;
+    _lastSTime = thisSTime;
   }
 }
 
@@ -49,23 +45,37 @@ void one_Rotation() {
 RainWind::RainWind() {};
 
 /*********************************************************************************************************
-begin(): initiates RainWind object: attaches 2 interrupts, sets pin modes and calls 3 "reset" methods
+begin(): initiates RainWind object: sets pin modes, starts a pulse counter for each detector (or attaches its
+interrupt if there is none) and calls 3 "reset" methods
 parameters: none
 returns: void
 **********************************************************************************************************/
 void RainWind::begin() {
-  attachInterrupt(digitalPinToInterrupt(RainPin), buckets_tipped, CHANGE); // rain buckets
-  attachInterrupt(digitalPinToInterrupt(RevsPin), one_Rotation, CHANGE);  // anemometer
-  
   //set pin modes
-  pinMode(RainPin, INPUT_PULLUP); 
-  pinMode(RevsPin, INPUT_PULLUP);
-  pinMode(WDPin, INPUT_PULLUP);
-  
+  halPinMode(RainPin, INPUT_PULLUP); 
+  halPinMode(RevsPin, INPUT_PULLUP);
+  halPinMode(WDPin, INPUT_PULLUP);
+
+  _rainCounted = PULSE_COUNTER && halCounterBegin(RAIN_COUNTER, RainPin, PULSE_FILTER_NS);
+  _windCounted = PULSE_COUNTER && WIND_PULSE_COUNTER && halCounterBegin(WIND_COUNTER, RevsPin, PULSE_FILTER_NS);
+  if (!_rainCounted) halAttachISR(RainPin, buckets_tipped, CHANGE); // rain buckets
+  if (!_windCounted) halAttachISR(RevsPin, one_Rotation, CHANGE);  // anemometer
+  if (PULSE_COUNTER && !(_rainCounted && (_windCounted || !WIND_PULSE_COUNTER))) halLog("Pulse counters unavailable: interrupts instead");
+  _rainCount = _rainCounted ? halCounterRead(RAIN_COUNTER) : 0;
+  _windCount = _windCounted ? halCounterRead(WIND_COUNTER) : 0;
+
   for (int hr = 0; hr < HPD; hr++) {
     resetHour(hr);
   }
+  _stats.begin((uint32_t)halMicros());
+  _gustUs = (uint32_t)halMicros();
+  _dir.begin();
+  _results.buckets = 0;
+  _results.revs3 = 0;
   _results.maxRevs = 0;
+  _results.wd = NUL_WD;
+  _results.revs2Min = 0;
+  _results.revs10Min = 0;
 }
 
 /***********************************************************************************************************
@@ -77,34 +87,26 @@ returns: void
 void RainWind::resetHour(int hr) { // STILL NEEDED I THINK! MAYBE NOT AFTER ResetHour reinstated
   _prevTips = _hrTipsCount;
   _hrTipsCount = 0;
-  _hrRevs = 0;
-  _gustHr = 0;
   _hesults[hr].bucketsHr = 0;
   _hesults[hr].gustHr = 0;
   _hesults[hr].revsHr = 0;
+  _hesults[hr].meanHr = 0;
+  _hesults[hr].sdHr = 0;
+  _hesults[hr].wdHr = NUL_WD;
+  for (int i = 0; i < WS_HIST_BINS; i++) _hesults[hr].histHr[i] = 0;
 }
 
 // Various methods to update values in "real time" zones -----------------------------------------
 
 /*************************************************************************************************
-onWDUpdate(): adds revs count since last call to the total for the wind direction (called every 3 secs)
+onWDUpdate(): takes the wind direction over the realtime interval just ended (called every 3 secs, after
+updateRevs()): the vector mean of the vane readings added since the last call, weighted by the revs
 parameters: none
-returns: int: the analog reading / 128 (0-31)
+returns: int: direction in degrees (0-359), NUL_WD if there were no vane readings
 **************************************************************************************************/
 int RainWind::onWDUpdate() {
-  int revs;
-  _currAnalog = getAnalog();
-  _results.ana128 = _currAnalog; 
-  return _results.ana128;
-}
-
-/**************************************************************************************************
-getAnalog(): returns current vane analogur value (0 - 4095)
-parameters: none
-returns: int: wind direction analogue value (0 - 4095) 
-***************************************************************************************************/
-int RainWind::getAnalog() {
-  return analogRead(WDPin);  // this produces analog values between 0 and 4095
+  _results.wd = _dir.takeRT();
+  return _results.wd;
 }
 /*
 // 8-pin version
@@ -125,36 +127,82 @@ int WDPosition(int inVal) {
 }
 */
 /**************************************************************************************************
-updateRevs(): results stored in one of 12 array posistions (12 == 3 secs speed measurement interval / 0.25 secs poll interval)
-(polled 4 times a second to catch gusts)
+updateRevs(): takes the anemometer pulses since the last call into the wind statistics and brings the
+realtime wind results up to date. From the ISR, the pulse timestamps are drained from the ring: gusts are
+exact whenever (and however rarely) this is called, as long as the ring does not fill up between calls.
+From the counter, the pulses are counted now: call it every tick (WS_BIN_US) for exact gusts.
 parameters: none
 returns: void
 ***************************************************************************************************/
 void RainWind::updateRevs() { 
-  int revsNow = _currRevs; // from last interrupt
-  int revsInc = revsNow - _pollRevs[_ixPoll];
-  revsInc = max(0, revsInc);
-  _results.revs3 = revsInc;
-  _hrRevs += revsInc;
-  _pollRevs[_ixPoll] = revsNow;
-
-  if (revsInc > _results.maxRevs) {
-    _results.maxRevs = _results.revs3;
+  uint32_t now = (uint32_t)halMicros();
+  int revs = 0;
+  if (_windCounted) {
+    uint32_t count = halCounterRead(WIND_COUNTER);
+    revs = (int)(count - _windCount);
+    _windCount = count;
+    _stats.addPulses(now, revs);
   }
-
-  if (revsInc > _gustHr) {
-    _gustHr = revsInc;
+  else {
+    uint32_t t;
+    while (_pulses.pop(&t)) {
+      _stats.addPulse(t);
+      revs++;
+    }
   }
+  _dir.weigh(revs);  // the vane readings since the last call count for these revs
+  _stats.advanceTo(now);
+  _results.revs3 = _stats.gust3s();  // revs in last 3 seconds
+  _results.revs2Min = _stats.revs2Min();
+  _results.revs10Min = _stats.revs10Min();
+}
 
-  _ixPoll = (_ixPoll + 1) % POLL_COUNT;
+/**************************************************************************************************
+takeRTGust(): sets maxRevs to the highest 3 sec revs since the previous realtime sample, and notes when it
+was reached (called once per realtime sample, after updateRevs())
+parameters: none
+returns: void
+***************************************************************************************************/
+void RainWind::takeRTGust() {
+  _results.maxRevs = _stats.takeRtGust(&_gustUs);
+}
+
+/**************************************************************************************************
+tipUs(): when the latest rain bucket tip was seen: from the ISR, the tip itself; from the counter, the poll
+that found it
+parameters: none
+returns: uint32_t: halMicros() of the tip (0 if none since boot)
+***************************************************************************************************/
+uint32_t RainWind::tipUs() {
+  return _lastRTime;
+}
+
+/**************************************************************************************************
+pulseOverflows(): reports anemometer pulses lost because the ring was full
+parameters: none
+returns: unsigned int: number of pulses lost since boot (none when counted in hardware)
+***************************************************************************************************/
+unsigned int RainWind::pulseOverflows() {
+  return _pulses.overflows();
 }
 
 /*************************************************************************************************
-updateBucketTips(): stores the current value of volatile _cumTipsCount
+updateBucketTips(): stores the current value of volatile _cumTipsCount, first adding the tips counted by the
+rain gauge's counter since the last call: at most RAIN_TIPS_POLL_MAX, as the glitch filter is far too short
+for a reed switch's bounce
 parameters: none
 returns: void
 **************************************************************************************************/
 void RainWind::updateBucketTips() {
+  if (_rainCounted) {
+    uint32_t count = halCounterRead(RAIN_COUNTER);
+    int tips = (int)(count - _rainCount);
+    _rainCount = count;
+    if (tips > RAIN_TIPS_POLL_MAX) tips = RAIN_TIPS_POLL_MAX;
+    _cumTipsCount += tips;
+    _hrTipsCount += tips;
+    if (tips > 0) _lastRTime = (uint32_t)halMicros();
+  }
   _results.buckets = _cumTipsCount; // cumulates for whole day
 }
 
@@ -165,52 +213,70 @@ parameters:
 returns: void
 **************************************************************************************************/
 void RainWind::storeHrResults(int hr) {
-  _hesults[hr].bucketsHr = _hrTipsCount - _prevTips;
-  _hesults[hr].revsHr = _hrRevs;
-  //_hrTipsCount = 0;
-  _hesults[hr].gustHr = _gustHr;
+  int tips = _hrTipsCount;
+  windHour wh;
+  _stats.takeHour(&wh);  // also starts the next hour's statistics
+  _hesults[hr].bucketsHr = tips - _prevTips;
+  _hesults[hr].revsHr = wh.revs;
+  _hesults[hr].gustHr = wh.gust;
+  _hesults[hr].meanHr = wh.mean10;
+  _hesults[hr].sdHr = wh.sd10;
+  _hesults[hr].wdHr = _dir.takeHour();
+  for (int i = 0; i < WS_HIST_BINS; i++) _hesults[hr].histHr[i] = wh.hist[i];
+  // start the next hour
+  _prevTips = tips;
+}
+
+/*************************************************************************************************
+resetDay(): restarts the daily bucket tips count (called at midnight)
+parameters: none
+returns: void
+**************************************************************************************************/
+void RainWind::resetDay() {
+  _cumTipsCount = 0;
+  _results.buckets = 0;
 }
 
 /***************************************************************************************************
-getCSVRT(): puts realtime values into CSV buffer rtBuf
-parameters: char* realtime buffer address
+getCSVRT(): appends the realtime values as CSV to a message
+parameters: mw: MsgWriter&: the message being built
 returns: void
 ****************************************************************************************************/
-void RainWind::getCSVRT(char *rtBuf) {
-  makeCSV(_results, rtBuf);
+void RainWind::getCSVRT(MsgWriter& mw) {
+  makeCSV(_results, mw);
 }
 
 /**************************************************************************************************
-makeCSV(): converts integer values in wr struct to CSV string (character field width 4 per item)
+makeCSV(): appends the integer values in a wr struct as CSV (layout CSV_RW_RT: field width 4 per item)
 parameters:
-  vals: a wr structure to hold the RT and hourly values
-  buf: char*: character buffer to hold string: buffer length BUF_LEN (currently 84)
-returns: boolean: always true
+  vals: a wr structure holding the RT values
+  mw: MsgWriter&: the message being built
+returns: void
 ***************************************************************************************************/
-bool RainWind::makeCSV(wr vals, char *buf) {
-  sprintf(buf, ",%04d,%04d,%04d,%04d", vals.buckets, vals.revs3, vals.maxRevs, vals.ana128);
-  return true;
+void RainWind::makeCSV(const wr& vals, MsgWriter& mw) {
+  const long f[] = { vals.buckets, vals.revs3, vals.maxRevs, vals.wd };
+  mw.putCSV(CSV_RW_RT, f);
 }
 
 /**************************************************************************************************
-makeCSVHr(): converts integer values in wr struct to CSV string (character field width 4 per item)
+makeCSVHr(): appends the integer values in a wrHr struct as CSV (layout CSV_RW_HR: field width 4 per item)
 parameters:
-  vals: a wrHr structure to hold the hourly values
-  buf: char*: character buffer to hold string: buffer length BUF_LEN (currently 84)
-returns: boolean: always true
+  vals: a wrHr structure holding the hourly values
+  mw: MsgWriter&: the message being built
+returns: void
 ***************************************************************************************************/
-bool RainWind::makeCSVHr(wrHr vals, char *buf) {
-  sprintf(buf, ",%04d,%04d,%04d,%04d", vals.bucketsHr, vals.revsHr, vals.gustHr, NUL_WD);
-  return true;
+void RainWind::makeCSVHr(const wrHr& vals, MsgWriter& mw) {
+  const long f[] = { vals.bucketsHr, vals.revsHr, vals.gustHr, vals.wdHr };
+  mw.putCSV(CSV_RW_HR, f);
 }
 
 /**************************************************************************************************
-getCSVHour(): takes values from requested hr wr array item and converts to CSV and stores into buf
+getCSVHour(): takes values from requested hr wr array item and appends them as CSV to a message
 parameters:
   hr: int: hour (0-23)
-  buf: char*: pointer to character buffer to hold CSV string: length BUF_LEN (currently 84)
+  mw: MsgWriter&: the message being built
 returns: void
 ***************************************************************************************************/
-void RainWind::getCSVHour(int hr, char *buf) {
-  makeCSVHr(_hesults[hr], buf);
+void RainWind::getCSVHour(int hr, MsgWriter& mw) {
+  makeCSVHr(_hesults[hr], mw);
 }
@@ -1,14 +1,20 @@
 #ifndef RAINWIND_H
 #define RAINWIND_H
 
-#include "Arduino.h"
+#include "Hal.h"
+#include "Config.h"
+#include "MsgWriter.h"
+#include "WindStats.h"
+#include "WindDir.h"
 
 // Structure used to hold windrain data
 struct wr {
   int buckets;  // tips since midnight
   int revs3;  // revs in last 3 seconds
-  int maxRevs;  // gust measure (3 secs)
-  int ana128; // WD analogue sensor reading 
+  int maxRevs;  // gust measure: highest 3 sec revs since the previous realtime sample
+  int wd;  // wind direction over the last realtime interval: degrees (NUL_WD: no vane readings)
+  int revs2Min;  // revs in last 2 minutes
+  int revs10Min;  // revs in last 10 minutes
 };
 
 // struct to hold hourly BACKUP data
@@ -16,41 +22,58 @@ struct wrHr {
   int bucketsHr;
   int revsHr;
   int gustHr;
+  int meanHr;  // mean 3 sec revs x 10
+  int sdHr;  // standard deviation of 3 sec revs x 10
+  int wdHr;  // revs-weighted vector mean wind direction: degrees (NUL_WD: calm)
+  uint16_t histHr[WS_HIST_BINS];  // quarter seconds in each 3 sec revs band
 };
 // ----------------------------------------------------------------------------------------------------------
-//-------------------------------------- Version of 21.08.2024 ----------------------------------------------
+//-------------------------------------- Version of 17/10/2026 ----------------------------------------------
 
 // Class RainWind(): interface with the wind and rain detectors
+// Pulses come from one of two sources, chosen per detector by begin():
+//   the PCNT peripheral (PULSE_COUNTER): counted in hardware behind its glitch filter, polled by updateRevs()
+//   (every tick: each poll's count is timed by the poll) and updateBucketTips(); no CPU work per edge
+//   an interrupt per edge (fallback): debounced in software; anemometer pulses are timestamped into a ring
+// The anemometer stays on its interrupt unless WIND_PULSE_COUNTER: the glitch filter (12.7 us at most) passes a
+// reed switch's bounce, and unlike a bucket tip, a rotation has no per-poll maximum low enough to clip it.
 
 class RainWind {
 
   public:
   RainWind();
   void begin();
+  void addVane(int raw, int n = 1) { _dir.add(raw, n); }
   int onWDUpdate();
   void updateRevs();
+  void takeRTGust();
+  uint32_t gustUs() { return _gustUs; }
+  uint32_t tipUs();
+  unsigned int pulseOverflows();
+  bool windCounted() { return _windCounted; }
   void updateBucketTips();
-  void getCSVRT(char* buf);
-  void getCSVHour(int hr, char* buf);
+  void getCSVRT(MsgWriter& mw);
+  wr getResults() { return _results; }
+  void getCSVHour(int hr, MsgWriter& mw);
   void storeHrResults(int hr);
+  wrHr getHrResults(int hr) { return _hesults[hr]; }
+  static void makeCSVHr(const wrHr& vals, MsgWriter& mw);
+  void resetDay();
 
   private:
-  //void resetDay();
   void resetHour(int h);
   //void initResults();
-  int getAnalog();
-  bool makeCSV(wr vals, char* buf);
-  bool makeCSVHr(wrHr vals, char *buf);
+  static void makeCSV(const wr& vals, MsgWriter& mw);
   
   // local (private) variables
   int _prevTips;
-  int _hrRevs;
-  int _gustHr;
-  int _currAnalog;
-  int _ixPoll;
+  bool _windCounted, _rainCounted;  // pulses counted by the PCNT peripheral, not the ISRs
+  uint32_t _windCount, _rainCount;  // counter readings at the last poll
+  uint32_t _gustUs;  // when the realtime gust (maxRevs) was reached
   wr _results;
   wrHr _hesults[HPD];
-  int _pollRevs[POLL_COUNT];
+  WindStats _stats;
+  WindDir _dir;
 };
 
 #endif
\ No newline at end of file
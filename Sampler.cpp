@@ -0,0 +1,409 @@
+#include "Config.h"
+#include "Hal.h"
+#include "Sampler.h"
+
+// ------------------------------ Version of 17/10/2026 ---------------------------------
+// Sampler class: the scheduled sampling jobs, run by the sampling task (see Station::startTasks()).
+// Everything bound for MQTT goes through the queues declared in Sampler.h.
+
+Sampler::Sampler() {};
+
+/*********************************************************************************************************
+begin(): initiates the Sampler: starts the clock, sensors and rain/wind detectors and adds the jobs
+The anemometer and rain gauge ISRs (if used) are attached to the core that calls begin(), so call it on
+SAMPLE_CORE.
+parameters: tb: Timebase&: the station's time (already begun)
+returns: void
+**********************************************************************************************************/
+void Sampler::begin(Timebase& tb) {
+  _tb = &tb;
+  _chrono.begin(tb);
+  _sensors.begin();
+  _rainWind.begin();
+  halPinMode(VoltsPin, INPUT);
+  const int adcPins[] = { WDPin, VoltsPin };
+  _adcRunning = halAdcStart(adcPins, 2, ADC_HZ);
+  if (!_adcRunning) halLog("Continuous ADC unavailable: single conversions");
+  _adcOverruns = 0;
+  _battSum = 0;
+  _battN = 0;
+  _battHr.clear();
+  _battDay.clear();
+  _rainDay.clear();
+  _scheduler.begin();
+  _scheduler.add("adc", 1);  // must follow the JOB_ order
+  _scheduler.add("rt", ZONE12);
+  _scheduler.add("sensors", 1);  // split-phase: a few bus transactions on 3 ticks of each SENS_CYCLE
+  _scheduler.add("battery", MAX_LOOP_COUNT);
+  _scheduler.add("rain", ZONE4);
+  _scheduler.add("revs", _rainWind.windCounted() ? 1 : ZONE4);  // a counter's pulses are timed by its poll
+  _volts = 0;
+  _pulsesLost = 0;
+  _frameSeq = 0;
+  _tipUs = _rainWind.tipUs();
+  _sampled = false;
+  _statTicks = 0;
+  calibrateProbe();
+}
+
+/*********************************************************************************************************
+tick(): runs one loop (1/4 sec) worth of sampling: whichever jobs are due. Reports the job charged with an
+overrun, if any.
+parameters: none
+returns: byte: activity flag (sum of the flags returned by the jobs that ran)
+**********************************************************************************************************/
+byte Sampler::tick() {
+  byte actFlag = 0;
+  _scheduler.startTick();
+  for (int id = 0; id < _scheduler.jobs(); id++) {
+    if (!_scheduler.due(id)) continue;
+    _scheduler.startJob();
+    actFlag += runJob(id);
+    _scheduler.endJob(id);
+  }
+
+  int late = _scheduler.endTick();
+  if (late >= 0) {  // Code took over LOOP_TIME
+    char mBuf[BUF_LEN];
+    const schedJob& jb = _scheduler.job(late);
+    sprintf(mBuf, "Long loop time: %lu us; Flag: %x; Job: %s (%lu us, %lu overruns)", _scheduler.tickUs(), actFlag,
+      jb.name, jb.lastUs, jb.overruns);
+    queueMessage(mBuf);
+  }
+  if (++_statTicks >= STATS_TICKS) queueStats();
+  return actFlag;
+}
+
+/*********************************************************************************************************
+waitForNextTick(): sleeps until the next tick is due (LOOP_TIME after the previous one)
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Sampler::waitForNextTick() {
+  _scheduler.sleep();
+}
+
+/*********************************************************************************************************
+runJob(): runs one scheduled job
+parameters: id: int: JOB_ identifier
+returns: byte: the job's activity flag
+**********************************************************************************************************/
+byte Sampler::runJob(int id) {
+  switch (id) {
+    case JOB_ADC: return jobAdc();
+    case JOB_RT: return jobRT();
+    case JOB_SENSORS: return jobSensors();
+    case JOB_BATTERY: return jobBattery();
+    case JOB_RAIN: return jobRain();
+    case JOB_REVS: return jobRevs();
+  }
+  return 0;
+}
+
+/*********************************************************************************************************
+jobAdc(): EVERY LOOP: collects the conversions made in the background since the last tick, summed per pin and
+DMA frame by the HAL (about 40 entries a tick instead of 5000 conversions): each frame's mean vane reading goes to
+the wind direction weighted by its conversions, the battery sums to the battery average. Without continuous
+conversions, one single conversion of each pin.
+parameters: none
+returns: byte: activity flag (0)
+**********************************************************************************************************/
+byte Sampler::jobAdc() {
+  if (!_adcRunning) {
+    _rainWind.addVane(halAnalogRead(WDPin));
+    _battSum += halAnalogRead(VoltsPin);
+    _battN++;
+    return 0;
+  }
+  adcSample buf[ADC_CHUNK];
+  int n;
+  while ((n = halAdcCollect(buf, ADC_CHUNK)) > 0) {
+    for (int i = 0; i < n; i++) {
+      const adcSample& s = buf[i];
+      if (s.pin == WDPin) {
+        int32_t half = s.sum >= 0 ? s.count / 2 : -(s.count / 2);  // rounded mean difference
+        _rainWind.addVane((s.first + (s.sum + half) / s.count) & 4095, s.count);
+      }
+      else {
+        _battSum += (int64_t)s.first * s.count + s.sum;
+        _battN += s.count;
+      }
+    }
+  }
+  unsigned long lost = halAdcOverruns();
+  if (lost != _adcOverruns) {
+    char mBuf[BUF_LEN];
+    sprintf(mBuf, "ADC conversions lost: %lu", lost);
+    queueMessage(mBuf);
+    _adcOverruns = lost;
+  }
+  return 0;
+}
+
+/*********************************************************************************************************
+jobRain(): EVERY 4 LOOPS (1 sec): bucket tips and hourly results
+parameters: none
+returns: byte: activity flag (1, plus 2 at the end of an hour)
+**********************************************************************************************************/
+byte Sampler::jobRain() {
+  byte actFlag = 1;
+  _rainWind.updateBucketTips();
+  if (_chrono.hourChanged()) {  // one compare per call except at the hour boundary
+    onHourChanged();
+    actFlag += 2;
+  }
+  return actFlag;
+}
+
+/*********************************************************************************************************
+jobRevs(): EVERY 4 LOOPS (1 sec), or EVERY LOOP from the pulse counter: takes the anemometer pulses into the
+wind statistics
+parameters: none
+returns: byte: activity flag (0)
+**********************************************************************************************************/
+byte Sampler::jobRevs() {
+  _rainWind.updateRevs();
+  return 0;
+}
+
+/*********************************************************************************************************
+onHourChanged(): stores the hour just ended in the hourly arrays and queues it for the history log, rolls it
+up into the day's statistics and, at midnight, ends the day and starts a new rain day (not after a day since
+boot, ended by the time being set: its tips count in the day the time is then known to be)
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Sampler::onHourChanged() {
+  int hr = _chrono.prevHour();
+  _rainWind.updateRevs();
+  _rainWind.storeHrResults(hr);
+  _sensors.storeHrResults(hr);
+  histRec rec;
+  rec.hour2k = _chrono.prevHourStamp();
+  rec.rw = _rainWind.getHrResults(hr);
+  rec.s = _sensors.getHrResults(hr);
+  takeBattHour(&rec.batt);
+  _rainDay.add(rec.rw.bucketsHr);
+  if (rec.hour2k >= TIME_VALID_2K / SECS_PER_HOUR) {  // not an hour since boot (ended by the time being set)
+    if (!_hours.push(rec)) queueMessage("Hourly results lost: queue full");
+  }
+  postBusTimes();
+  if (_chrono.dayChanged()) {
+    uint32_t day2k = rec.hour2k / HPD;
+    if (day2k >= TIME_VALID_2K / SECS_PER_DAY) _rainWind.resetDay();  // a day since boot: its tips carry over
+    onDayChanged(day2k);
+  }
+}
+
+/*********************************************************************************************************
+takeBattHour(): the battery statistics of the hour just ended (the latest voltage if there was no reading in
+it), rolled up into the day's
+parameters: bh: battHr* to receive them
+returns: void
+**********************************************************************************************************/
+void Sampler::takeBattHour(battHr* bh) {
+  bool read = _battHr.count() > 0;
+  bh->mean = read ? _battHr.mean() : _volts;
+  bh->lo = read ? _battHr.min() : _volts;
+  bh->hi = read ? _battHr.max() : _volts;
+  _battDay.merge(_battHr);
+  _battHr.clear();
+}
+
+/*********************************************************************************************************
+onDayChanged(): ends the day: queues its statistics, rolled up from its hours, and starts the next. A day since
+boot (ended by the time being set) is dropped.
+parameters: day2k: uint32_t: the day just ended (days since 1/1/2000)
+returns: void
+**********************************************************************************************************/
+void Sampler::onDayChanged(uint32_t day2k) {
+  dayRec d;
+  d.day2k = day2k;
+  d.hours = (int)_rainDay.count();
+  d.buckets = (int)_rainDay.sum();
+  d.bucketsHi = _rainDay.max();
+  _sensors.takeDay(&d.s);
+  d.batt.mean = _battDay.mean();
+  d.batt.lo = _battDay.min();
+  d.batt.hi = _battDay.max();
+  _rainDay.clear();
+  _battDay.clear();
+  if (day2k < TIME_VALID_2K / SECS_PER_DAY) return;
+  if (!_days.push(d)) queueMessage("Daily results lost: queue full");
+}
+
+/*********************************************************************************************************
+jobRT(): EVERY 12 LOOPS (3 secs): wind speed and direction, queued as a realtime frame for posting
+parameters: none
+returns: byte: activity flag (8, plus 64 once the frame is queued)
+**********************************************************************************************************/
+byte Sampler::jobRT() {
+  byte actFlag = 8;
+  _rainWind.updateRevs();  // anemometer pulses since the last call
+  _rainWind.takeRTGust();
+  unsigned int lost = _rainWind.pulseOverflows();
+  if (lost != _pulsesLost) {
+    char mBuf[BUF_LEN];
+    sprintf(mBuf, "Anemometer pulses lost: %u", lost);
+    queueMessage(mBuf);
+    _pulsesLost = lost;
+  }
+  _rainWind.onWDUpdate();
+  rtFrame fr;
+  makeFrame(&fr);
+  if (_frames.push(fr)) actFlag += 64;  // a full queue is reported by the network side
+  halDigitalWrite(LEDPin, !halDigitalRead(LEDPin)); // blink
+  return actFlag;
+}
+
+/*********************************************************************************************************
+jobSensors(): EVERY LOOP: the I2C sensors' acquisition step (starts or collects conversions, never waits)
+parameters: none
+returns: byte: activity flag (128 if the step used the bus)
+**********************************************************************************************************/
+byte Sampler::jobSensors() {
+  return _sensors.step() ? 128 : 0;
+}
+
+/*********************************************************************************************************
+jobBattery(): EVERY MAX_LOOP_COUNT LOOPS (30 secs): battery voltage, into the hour's statistics
+parameters: none
+returns: byte: activity flag (0)
+**********************************************************************************************************/
+byte Sampler::jobBattery() {
+  bool read = _battN > 0;
+  _volts = checkBattery();
+  if (read) _battHr.add(_volts);
+  return 0;
+}
+
+/*******************************************************************************************************************
+makeFrame(): fills a rtFrame with the current realtime values, the next sequence number and the time now, and
+starts its trace: capture time and how long ago the latest rain tip and the gust were
+parameters: fr: rtFrame* to be filled
+returns: void
+********************************************************************************************************************/
+void Sampler::makeFrame(rtFrame* fr) {
+  wr w = _rainWind.getResults();
+  sens s = _sensors.getResults();
+  uint32_t tip = _rainWind.tipUs();
+  fr->capUs = (uint32_t)halMicros();
+  uint64_t us = _tb->nowUs();
+  fr->seq = _frameSeq++;
+  fr->time2k = (uint32_t)(us / 1000000ULL);  // seconds since boot (below TIME_VALID_2K) until the time is known
+  fr->capFrac = (uint32_t)(us % 1000000ULL);
+  fr->tipAge = (tip != _tipUs) ? (int32_t)(fr->capUs - tip) : -1;
+  fr->gustAge = (w.maxRevs > 0) ? (int32_t)(fr->capUs - _rainWind.gustUs()) : -1;
+  fr->queueUs = 0;
+  _tipUs = tip;
+  if (!_sampled) {
+    char mBuf[BUF_LEN];
+    sprintf(mBuf, "First sample %lu ms after boot", halMillis());
+    queueMessage(mBuf);
+    _sampled = true;
+  }
+  fr->buckets = w.buckets;
+  fr->revs3 = w.revs3;
+  fr->maxRevs = w.maxRevs;
+  fr->wd = w.wd;
+  fr->revs2Min = w.revs2Min;
+  fr->revs10Min = w.revs10Min;
+  for (int i = 0; i < SENS_FIELDS; i++) fr->sens[i] = s.v[i];
+  fr->volts = _volts;
+}
+
+/*******************************************************************************************************************
+postBusTimes(): queues the I2C bus time of each sensor: its whole acquisition cycle / its longest single tick (us)
+parameters: none
+returns: void
+********************************************************************************************************************/
+void Sampler::postBusTimes() {
+  char mBuf[BUF_LEN];
+  MsgWriter mw(mBuf, BUF_LEN);
+  mw.putStr("I2C us:");
+  for (int i = 0; i < SENS_COUNT; i++) {
+    mw.put(' ');
+    mw.putStr(Sensors::name(i));
+    mw.put(' ');
+    mw.putUInt(_sensors.timing(i).cycleUs);
+    mw.put('/');
+    mw.putUInt(_sensors.timing(i).maxUs);
+  }
+  queueMessage(mw.text());
+}
+
+/*******************************************************************************************************************
+queueStats(): closes the statistics period: queues its latency summaries (tick, each job, each sensor's bus time)
+and the cost of the instrumentation itself as one item, then starts a new period. Its arrival tells the network
+side to post the period (see Station::postStats()).
+parameters: none
+returns: void
+********************************************************************************************************************/
+void Sampler::queueStats() {
+  statPeriod sp;
+  sp.n = 0;
+  uint32_t probes = _scheduler.tickHist().count();
+  _scheduler.tickHist().summary("tick", &sp.recs[sp.n++]);
+  _scheduler.tickHist().clear();
+  for (int id = 0; id < _scheduler.jobs(); id++) {
+    probes += _scheduler.jobHist(id).count();
+    _scheduler.jobHist(id).summary(_scheduler.job(id).name, &sp.recs[sp.n++]);
+    _scheduler.jobHist(id).clear();
+  }
+  for (int i = 0; i < SENS_COUNT; i++) {
+    probes += _sensors.hist(i).count();
+    _sensors.hist(i).summary(Sensors::name(i), &sp.recs[sp.n++]);
+    _sensors.hist(i).clear();
+  }
+  uint64_t budgetCy = (uint64_t)_statTicks * LOOP_TIME * 1000 * halCyclesPerUs();
+  sp.ovh.probes = probes;
+  sp.ovh.probeCy = _probeCy;
+  sp.ovh.ppm = (uint32_t)((uint64_t)probes * _probeCy * 1000000ULL / budgetCy);
+  _stats.push(sp);
+  _statTicks = 0;
+}
+
+/*******************************************************************************************************************
+calibrateProbe(): measures the cost of one instrumentation probe (counter read before and after, plus a record)
+parameters: none
+returns: void
+********************************************************************************************************************/
+void Sampler::calibrateProbe() {
+  LatHist scratch;
+  uint32_t c0 = halCycles();
+  for (int i = 0; i < 64; i++) {
+    uint32_t t = halCycles();
+    scratch.record(halCycles() - t);
+  }
+  _probeCy = (halCycles() - c0) / 64;
+}
+
+/*******************************************************************************************************************
+queueMessage(): queues a text message for ws/messages (dropped if the queue is full)
+parameters: text: const char*: the message, without its 'M' header
+returns: void
+********************************************************************************************************************/
+void Sampler::queueMessage(const char* text) {
+  msgRec msg;
+  strncpy(msg.text, text, BUF_LEN - 1);
+  msg.text[BUF_LEN - 1] = '\0';
+  _messages.push(msg);
+}
+
+/*******************************************************************************************************************
+checkBattery(): battery voltage from the mean of the readings since the last call (some 300,000 with continuous
+conversions), calibrated: the mean is kept to 1/16 of a step and interpolated between the calibrated voltages
+of the steps either side
+parameters: none
+returns: int: battery voltage in centivolts (the previous value if there were no readings)
+********************************************************************************************************************/
+int Sampler::checkBattery() {
+  if (_battN == 0) return _volts;
+  uint32_t raw16 = (uint32_t)(_battSum * 16 / _battN);
+  _battSum = 0;
+  _battN = 0;
+  int raw = raw16 >> 4;
+  long mv = halAdcMillivolts(raw);
+  if (raw < 4095) mv += (halAdcMillivolts(raw + 1) - mv) * (long)(raw16 & 15) / 16;
+  return (int)(mv * BATT_DIVIDER / 10);
+}
@@ -0,0 +1,123 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "Hal.h"
+#include "Config.h"
+#include "RainWind.h"
+#include "Sensors.h"
+#include "Chrono.h"
+#include "Telemetry.h"
+#include "HistLog.h"
+#include "Scheduler.h"
+#include "SpscRing.h"
+#include "LatHist.h"
+#include "Accum.h"
+
+// Scheduled jobs, in the order they are added to the Scheduler (heaviest first, for the phase choice; the ADC
+// collection, every tick, first so the other jobs see its readings)
+enum { JOB_ADC, JOB_RT, JOB_SENSORS, JOB_BATTERY, JOB_RAIN, JOB_REVS };
+
+// Structure holding one text message queued for ws/messages
+struct msgRec {
+  char text[BUF_LEN];
+};
+
+// Structure holding the instrumentation's own cost over a statistics period
+struct ovhRec {
+  uint32_t probes;  // probes (timed ticks, jobs and sensor steps) in the period
+  uint32_t probeCy;  // cycles per probe
+  uint32_t ppm;  // probe time in parts per million of the period's loop budget
+};
+
+// Structure holding one closed statistics period, queued whole: the network side posts it when it arrives, so
+// every ws/stats message covers exactly one period of the sampling task
+struct statPeriod {
+  int n;  // summaries: tick, each job, each sensor's bus time
+  statRec recs[1 + SCHED_MAX_JOBS + SENS_COUNT];
+  ovhRec ovh;
+};
+
+// Structure holding one day's statistics, rolled up from its hours, queued for the 'D' message
+struct dayRec {
+  uint32_t day2k;  // days since 1/1/2000
+  int hours;  // hours rolled up (fewer than HPD in the first day after a boot)
+  int buckets;  // rain: tips in the day
+  int bucketsHi;  // and in its wettest hour
+  sensDay s;
+  battHr batt;
+};
+
+// ----------------------------------------------------------------------------------------------------------
+//-------------------------------------- Version of 17/10/2026 ----------------------------------------------
+
+// Class Sampler: the sampling side of the station. It owns the RainWind, Sensors and Chrono objects and runs
+// their scheduled jobs; it never touches the network. Its results leave through lock-free queues (realtime
+// frames, completed hours and days and text messages, plus each closed STATS_SECS period's latency
+// statistics) which the network side (Station) drains, so a stalled or reconnecting MQTT link cannot delay a
+// sample. Each queue has one producer (the sampling task) and one consumer (the network task); a full queue
+// drops the newest item and counts it.
+
+class Sampler {
+
+  public:
+  Sampler();
+  void begin(Timebase& tb);
+  byte tick();
+  void waitForNextTick();
+
+  // Consumer side of the queues (network task only)
+  bool popFrame(rtFrame* fr) { return _frames.pop(fr); }
+  bool popHour(histRec* rec) { return _hours.pop(rec); }
+  bool popDay(dayRec* rec) { return _days.pop(rec); }
+  bool popMessage(msgRec* msg) { return _messages.pop(msg); }
+  bool popStats(statPeriod* sp) { return _stats.pop(sp); }
+  unsigned int framesDropped() { return _frames.overflows(); }
+
+  // Jobs one at a time, outside tick(): for the host benchmark (host/LoopBench.cpp) only
+  byte runJob(int id);
+  int jobs() { return _scheduler.jobs(); }
+  const schedJob& job(int id) { return _scheduler.job(id); }
+
+  private:
+  byte jobAdc();
+  byte jobRT();
+  byte jobSensors();
+  byte jobBattery();
+  byte jobRain();
+  byte jobRevs();
+  void onHourChanged();
+  void takeBattHour(battHr* bh);
+  void onDayChanged(uint32_t day2k);
+  void makeFrame(rtFrame* fr);
+  void queueMessage(const char* text);
+  void postBusTimes();
+  void queueStats();
+  void calibrateProbe();
+  int checkBattery();
+
+  RainWind _rainWind;
+  Sensors _sensors;
+  Chrono _chrono;
+  Timebase* _tb;
+  Scheduler _scheduler;
+  int _volts;
+  bool _adcRunning;  // continuous conversions (otherwise one single conversion of each pin per tick)
+  unsigned long _adcOverruns;
+  uint64_t _battSum;  // battery readings since the last jobBattery()
+  uint32_t _battN;
+  Accum _battHr, _battDay;  // battery voltages (one per jobBattery()) in the current hour and day
+  Accum _rainDay;  // the day's hourly rain totals
+  unsigned int _pulsesLost;
+  uint16_t _frameSeq;
+  uint32_t _tipUs;  // latest rain tip already traced
+  bool _sampled;  // first sample taken (and its time since boot reported)
+  SpscRing<rtFrame, FRAME_QUEUE_LEN> _frames;
+  SpscRing<histRec, HOUR_QUEUE_LEN> _hours;
+  SpscRing<dayRec, DAY_QUEUE_LEN> _days;
+  SpscRing<msgRec, MSG_QUEUE_LEN> _messages;
+  SpscRing<statPeriod, STAT_QUEUE_LEN> _stats;
+  int _statTicks;  // ticks in the current statistics period
+  uint32_t _probeCy;  // measured cost of one instrumentation probe (two counter reads and a record)
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "Scheduler.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Scheduler class: staggered periodic jobs on a LOOP_TIME tick (see Scheduler.h)
+
+Scheduler::Scheduler() {};
+
+/*********************************************************************************************************
+begin(): removes all jobs and sets the first deadline to now
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Scheduler::begin() {
+  _numJobs = 0;
+  _tick = 0;
+  _deadline = halMillis();
+  _overrunJob = -1;
+  _tickUs = 0;
+  _tickHist.clear();
+  for (int j = 0; j < SCHED_MAX_JOBS; j++) _jobHist[j].clear();
+}
+
+/*********************************************************************************************************
+add(): adds a job, choosing its phase to flatten the load: over the MAX_LOOP_COUNT ticks of a full cycle,
+the phase whose busiest tick already has the fewest jobs wins (ties: fewest jobs in total).
+Add the heaviest jobs first.
+parameters:
+  name: const char*: job name used in reports
+  period: int: ticks between runs (must divide MAX_LOOP_COUNT)
+returns: int: job id (runs in order of id within a tick), -1 if the table is full
+**********************************************************************************************************/
+int Scheduler::add(const char* name, int period) {
+  if (_numJobs >= SCHED_MAX_JOBS) return -1;
+  int load[MAX_LOOP_COUNT];
+  for (int t = 0; t < MAX_LOOP_COUNT; t++) load[t] = 0;
+  for (int j = 0; j < _numJobs; j++) {
+    for (int t = _jobs[j].phase; t < MAX_LOOP_COUNT; t += _jobs[j].period) load[t]++;
+  }
+  int best = 0, bestPeak = MAX_LOOP_COUNT, bestSum = MAX_LOOP_COUNT * SCHED_MAX_JOBS;
+  for (int p = 0; p < period; p++) {
+    int peak = 0, sum = 0;
+    for (int t = p; t < MAX_LOOP_COUNT; t += period) {
+      if (load[t] > peak) peak = load[t];
+      sum += load[t];
+    }
+    if (peak < bestPeak || (peak == bestPeak && sum < bestSum)) {
+      best = p;
+      bestPeak = peak;
+      bestSum = sum;
+    }
+  }
+  schedJob& jb = _jobs[_numJobs];
+  jb.name = name;
+  jb.period = period;
+  jb.phase = best;
+  jb.overruns = 0;
+  jb.lastUs = 0;
+  jb.maxUs = 0;
+  return _numJobs++;
+}
+
+/*********************************************************************************************************
+startTick(): marks the start of a tick's work
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Scheduler::startTick() {
+  _tickStartCy = halCycles();
+  _overrunJob = -1;
+}
+
+/*********************************************************************************************************
+due(): checks whether a job runs on this tick
+parameters: id: int: job id
+returns: boolean: true if due
+**********************************************************************************************************/
+bool Scheduler::due(int id) {
+  return (_tick % _jobs[id].period) == _jobs[id].phase;
+}
+
+void Scheduler::startJob() {
+  _jobStartCy = halCycles();
+}
+
+/*********************************************************************************************************
+endJob(): records a job's run time (last, longest and histogram) and charges it with an overrun if the tick
+has now gone past LOOP_TIME
+parameters: id: int: job id
+returns: void
+**********************************************************************************************************/
+void Scheduler::endJob(int id) {
+  uint32_t now = halCycles();
+  uint32_t cy = now - _jobStartCy;
+  schedJob& jb = _jobs[id];
+  _jobHist[id].record(cy);
+  jb.lastUs = cy / halCyclesPerUs();
+  if (jb.lastUs > jb.maxUs) jb.maxUs = jb.lastUs;
+  if (_overrunJob < 0 && ((now - _tickStartCy) / halCyclesPerUs() > 1000UL * LOOP_TIME)) {
+    _overrunJob = id;
+    jb.overruns++;
+  }
+}
+
+/*********************************************************************************************************
+endTick(): closes the tick's accounting and moves on to the next tick
+parameters: none
+returns: int: id of the job charged with an overrun on this tick, -1 if the tick kept to LOOP_TIME
+**********************************************************************************************************/
+int Scheduler::endTick() {
+  uint32_t cy = halCycles() - _tickStartCy;
+  _tickHist.record(cy);
+  _tickUs = cy / halCyclesPerUs();
+  _tick = (_tick + 1) % MAX_LOOP_COUNT;
+  return _overrunJob;
+}
+
+/*********************************************************************************************************
+sleep(): sleeps until the next tick's deadline (deadlines are LOOP_TIME apart, so they do not drift).
+After falling more than one tick behind, the schedule restarts from now rather than racing to catch up.
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Scheduler::sleep() {
+  _deadline += LOOP_TIME;
+  if ((long)(halMillis() - _deadline) > LOOP_TIME) _deadline = halMillis();
+  halSleepUntil(_deadline);
+}
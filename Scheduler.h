@@ -0,0 +1,58 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "Hal.h"
+#include "Config.h"
+#include "LatHist.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Scheduler: deadline-driven replacement for the loopCount % ZONE dispatch.
+// Each job has a period in loop ticks (LOOP_TIME each, dividing MAX_LOOP_COUNT) and a phase chosen when it is
+// added so that jobs land on ticks that are as lightly loaded as possible. Between ticks the task sleeps
+// until the next deadline instead of busy-waiting. The job running when a tick goes past LOOP_TIME is
+// charged with an overrun, so the culprit is named rather than the whole loop.
+// Ticks and jobs are timed with the cycle counter and recorded in latency histograms (LatHist).
+// Usage per tick: startTick(); for each job: if (due(id)) { startJob(); ...run it...; endJob(id); } endTick()
+
+// Structure holding one job's schedule and timings
+struct schedJob {
+  const char* name;
+  int period;  // ticks
+  int phase;  // tick (mod period) on which the job runs
+  unsigned long overruns;  // ticks which went past LOOP_TIME while this job ran
+  unsigned long lastUs;  // duration of the last run
+  unsigned long maxUs;  // longest run
+};
+
+class Scheduler {
+
+  public:
+  Scheduler();
+  void begin();
+  int add(const char* name, int period);
+  int jobs() { return _numJobs; }
+  const schedJob& job(int id) { return _jobs[id]; }
+
+  void startTick();
+  bool due(int id);
+  void startJob();
+  void endJob(int id);
+  int endTick();
+  unsigned long tickUs() { return _tickUs; }
+  LatHist& tickHist() { return _tickHist; }
+  LatHist& jobHist(int id) { return _jobHist[id]; }
+  void sleep();
+
+  private:
+  schedJob _jobs[SCHED_MAX_JOBS];
+  int _numJobs;
+  int _tick;
+  unsigned long _deadline;  // halMillis() at which the next tick starts
+  uint32_t _tickStartCy, _jobStartCy;
+  unsigned long _tickUs;
+  LatHist _tickHist;
+  LatHist _jobHist[SCHED_MAX_JOBS];
+  int _overrunJob;  // job charged with this tick's overrun, -1 if none
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "SensConv.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// SensConv: fixed point conversions and calibration (see SensConv.h)
+
+static const convCal _cal[CONV_COUNT] = CONV_CAL;
+
+// Compile-time log2 table: log2(1 + i / CONV_LOG_SEGS) in 1/65536 units, i = 0..CONV_LOG_SEGS
+constexpr double lnSeries(double x) {  // ln(x) = 2 atanh((x - 1) / (x + 1)): for 1 <= x <= 2, |y| <= 1/3
+  double y = (x - 1) / (x + 1), y2 = y * y, term = y, sum = 0;
+  for (int k = 0; k < 24; k++) {
+    sum += term / (2 * k + 1);
+    term *= y2;
+  }
+  return 2 * sum;
+}
+
+struct log2Table {
+  int32_t v[CONV_LOG_SEGS + 1];
+};
+
+constexpr log2Table makeLog2Table() {
+  log2Table t = {};
+  for (int i = 0; i <= CONV_LOG_SEGS; i++) t.v[i] = (int32_t)(lnSeries(1.0 + (double)i / CONV_LOG_SEGS) / lnSeries(2.0) * 65536 + 0.5);
+  return t;
+}
+
+static constexpr log2Table _log2 = makeLog2Table();
+static constexpr int32_t LOG2_12 = (int32_t)((3 + lnSeries(1.5) / lnSeries(2.0)) * 65536 + 0.5);  // log2(12)
+static constexpr int64_t LIGHT_K = (int64_t)(13 * lnSeries(2.0) * 65536 + 0.5);  // 13 ln(2)
+
+/*********************************************************************************************************
+log2Fixed(): base 2 logarithm from the table, interpolating linearly within a segment (error below 2e-4)
+parameters: v: uint32_t: argument (> 0)
+returns: int32_t: log2(v) in 1/65536 units
+**********************************************************************************************************/
+static int32_t log2Fixed(uint32_t v) {
+  int msb = 31 - __builtin_clz(v);
+  uint32_t m = v << (31 - msb);  // mantissa: 1.xxx with the point after bit 31
+  int ix = (m >> 26) & (CONV_LOG_SEGS - 1);
+  int32_t rem = (m >> 10) & 0xffff;  // position within the segment, 1/65536
+  int32_t lo = _log2.v[ix];
+  return (msb << 16) + lo + (int32_t)(((_log2.v[ix + 1] - lo) * rem) >> 16);
+}
+
+int32_t convAhtTemperature(uint32_t raw) {
+  return (int32_t)((raw * 200) >> (20 - CONV_FRAC_BITS)) - (50 << CONV_FRAC_BITS);
+}
+
+int32_t convAhtHumidity(uint32_t raw) {
+  return (int32_t)((raw * 100) >> (20 - CONV_FRAC_BITS));
+}
+
+int32_t convPressure(long pa) {
+  return (int32_t)(((int64_t)pa << CONV_FRAC_BITS) / 100);
+}
+
+/*********************************************************************************************************
+convLight(): light level 13 ln(1 + lux), lux = count / 1.2: computed as 13 ln2 (log2(12 + 10 count) - log2(12))
+parameters: raw: uint16_t: BH1750 count
+returns: int32_t: light level in 1/256 units
+**********************************************************************************************************/
+int32_t convLight(uint16_t raw) {
+  int32_t l2 = log2Fixed(12 + 10 * (uint32_t)raw) - LOG2_12;
+  return (int32_t)((l2 * LIGHT_K) >> (32 - CONV_FRAC_BITS));
+}
+
+/*********************************************************************************************************
+convOutput(): applies a result's calibration and rounds to the nearest integer
+parameters:
+  channel: int: CONV_ result
+  value: int32_t: converted value (1/256 units)
+returns: int: calibrated result
+**********************************************************************************************************/
+int convOutput(int channel, int32_t value) {
+  const convCal& c = _cal[channel];
+  int32_t v = (int32_t)(((int64_t)value * c.gain) >> CONV_GAIN_BITS) + c.offset;
+  return (int)((v + (1 << (CONV_FRAC_BITS - 1))) >> CONV_FRAC_BITS);
+}
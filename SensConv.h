@@ -0,0 +1,34 @@
+#ifndef SENSCONV_H
+#define SENSCONV_H
+
+#include "Hal.h"
+#include "Config.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// SensConv: the sensors' conversion stage, raw readings to calibrated results, in integer arithmetic only.
+// Each conversion gives its quantity in fixed point (CONV_FRAC_BITS fractional bits); convOutput() then applies
+// the unit's calibration (CONV_CAL in Config.h: gain and offset per result) and rounds to the integer reported.
+// The light level 13 ln(1 + lux) comes from a piecewise linear log2 table built at compile time.
+// SensConv.cpp has no board dependencies, so host tools check it against the floating point formulas.
+
+#define CONV_FRAC_BITS 8  // converted values are in 1/256 units
+#define CONV_GAIN_BITS 12
+#define CONV_GAIN_ONE (1 << CONV_GAIN_BITS)  // calibration gain of 1
+#define CONV_LOG_SEGS 32  // log2 table segments over each octave
+
+// Results, in the order of the calibration table
+enum convChannel { CONV_TEMPERATURE, CONV_HUMIDITY, CONV_PRESSURE, CONV_LIGHTA, CONV_LIGHTB, CONV_COUNT };
+
+// Structure holding one result's calibration: calibrated = value * gain / CONV_GAIN_ONE + offset
+struct convCal {
+  int32_t gain;
+  int32_t offset;  // in 1/256 units
+};
+
+int32_t convAhtTemperature(uint32_t raw);  // 20-bit AHT reading -> degrees C
+int32_t convAhtHumidity(uint32_t raw);  // 20-bit AHT reading -> %RH
+int32_t convPressure(long pa);  // compensated BMP085 pressure (Pa) -> hPa
+int32_t convLight(uint16_t raw);  // BH1750 count (high resolution mode) -> light level 13 ln(1 + lux)
+int convOutput(int channel, int32_t value);
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef SENSORSET_H
+#define SENSORSET_H
+
+#include "Hal.h"
+#include "Config.h"
+#include "MsgWriter.h"
+#include <tuple>
+#include <utility>
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// SensorSet: the station's sensor complement as a compile-time list of driver types. From the list come, at
+// compile time, the number of result fields, their CSV layout and binary widths (for the 'R'/'H' messages, the
+// realtime frame and the day block) and the acquisition step: one call per driver per tick, in list order,
+// unrolled by the compiler, with no run-time table or status checks.
+// A driver is a class with:
+//   NAME             short name, for the bus time statistics
+//   FIELDS           results it contributes
+//   FIELD[FIELDS]    their layout: CSV field and bytes in the binary frame (1 or 2; signed if the CSV field is)
+//   PERIOD           ticks per acquisition cycle
+//   PHASES           ticks at the start of each cycle on which step() is called (its cycle ends on the last)
+//   bool begin()     sets the sensor up (boot only: may wait); false if it is missing
+//   int step(int phase, int* out)     this phase's bus work, never waiting for a conversion: writes its
+//                    results (FIELDS of them) to out when it has them; returns SENS_BUS if it used the bus,
+//                    plus SENS_NEW if it wrote new readings (which then go into the hourly statistics)
+// When a read fails the driver decides what to report (the AHT and BMP keep their previous results) but
+// does not flag it SENS_NEW.
+
+#define SENS_BUS 1  // step() used the bus
+#define SENS_NEW 2  // step() wrote new readings
+
+// Structure describing one result field
+struct sensField {
+  csvField csv;
+  uint8_t bytes;  // in the binary frame
+};
+
+// The whole set's field layout, in list order
+template <int N> struct sensLayout {
+  csvField csv[N];
+  uint8_t bytes[N];
+};
+
+template <typename D, int N> constexpr void sensAppend(sensLayout<N>& l, int& n) {
+  for (int i = 0; i < D::FIELDS; i++) {
+    l.csv[n] = D::FIELD[i].csv;
+    l.bytes[n++] = D::FIELD[i].bytes;
+  }
+}
+
+// sensLayoutOf<Ds...>(): the set's field layout, at compile time
+template <typename... Ds> constexpr sensLayout<(0 + ... + Ds::FIELDS)> sensLayoutOf() {
+  sensLayout<(0 + ... + Ds::FIELDS)> l{};
+  int n = 0;
+  (sensAppend<Ds>(l, n), ...);
+  return l;
+}
+
+template <typename... Ds> class SensorSet {
+
+  public:
+  static constexpr int SENSORS = sizeof...(Ds);
+  static constexpr int FIELDS = (0 + ... + Ds::FIELDS);
+  static constexpr const char* NAMES[SENSORS] = { Ds::NAME... };
+  static constexpr int FIELDS_OF[SENSORS] = { Ds::FIELDS... };  // each sensor's fields, consecutive in list order
+  static constexpr sensLayout<FIELDS> LAYOUT = sensLayoutOf<Ds...>();
+
+  /*******************************************************************************************************
+  begin(): sets up every sensor
+  parameters: none
+  returns: uint32_t: bit i set if sensor i (list order) is missing
+  ********************************************************************************************************/
+  uint32_t begin() {
+    uint32_t missing = 0;
+    beginEach(missing, std::index_sequence_for<Ds...>());
+    return missing;
+  }
+
+  /*******************************************************************************************************
+  step(): runs one tick of every sensor's acquisition cycle
+  parameters:
+    tick: unsigned long: ticks since begin()
+    out: int[FIELDS]: the results, updated in place
+    cy: uint32_t[SENSORS]: receives each sensor's bus time this tick (cycles; 0 if it did not use the bus)
+    fresh: uint32_t*: receives bit i set if sensor i wrote new readings this tick
+  returns: uint32_t: bit i set if sensor i ended its cycle this tick
+  ********************************************************************************************************/
+  uint32_t step(unsigned long tick, int* out, uint32_t* cy, uint32_t* fresh) {
+    uint32_t ended = 0;
+    *fresh = 0;
+    stepEach(tick, out, cy, ended, *fresh, std::index_sequence_for<Ds...>());
+    return ended;
+  }
+
+  private:
+  // offset of driver I's results
+  template <size_t I> static constexpr int offset() {
+    constexpr int f[] = { Ds::FIELDS... };
+    int n = 0;
+    for (size_t i = 0; i < I; i++) n += f[i];
+    return n;
+  }
+
+  template <size_t... Is> void beginEach(uint32_t& missing, std::index_sequence<Is...>) {
+    ((missing |= std::get<Is>(_drivers).begin() ? 0 : 1UL << Is), ...);
+  }
+
+  template <size_t... Is> void stepEach(unsigned long tick, int* out, uint32_t* cy, uint32_t& ended,
+    uint32_t& fresh, std::index_sequence<Is...>) {
+    (stepOne<Is>(tick, out, cy, ended, fresh), ...);
+  }
+
+  template <size_t I> void stepOne(unsigned long tick, int* out, uint32_t* cy, uint32_t& ended, uint32_t& fresh) {
+    typedef typename std::tuple_element<I, std::tuple<Ds...>>::type D;
+    int phase = (int)(tick % D::PERIOD);
+    cy[I] = 0;
+    if (phase >= D::PHASES) return;
+    uint32_t t0 = halCycles();
+    int done = std::get<I>(_drivers).step(phase, out + offset<I>());
+    if (done & SENS_BUS) cy[I] = halCycles() - t0;
+    if (done & SENS_NEW) fresh |= 1UL << I;
+    if (phase == D::PHASES - 1) ended |= 1UL << I;
+  }
+
+  std::tuple<Ds...> _drivers;
+};
+
+#endif
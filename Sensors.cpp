@@ -1,158 +1,317 @@
 #include "Config.h"
-#include "Arduino.h"
+#include "Hal.h"
 #include "Sensors.h"
+#include "SensConv.h"
 
-// --------------------------------------- Version of 09/08/2024 ------------------------------------------
-// Sensors class acts as the interface between 4 I2C sensors and the main ino code
-Sensors::Sensors() : _aht(), _bmp()  {};
+// --------------------------------------- Version of 17/10/2026 ------------------------------------------
+// Sensors class acts as the interface between the I2C sensors (StationSensors) and the main ino code
+// The drivers are split-phase (see SensorSet.h) and reach the bus through the HAL's I2C burst transactions.
+// Raw readings become results through SensConv: fixed point, with this unit's calibration.
+Sensors::Sensors() {};
 
 /**********************************************************************************************************
-begin(): initializes the Sensors object: sets all _results (realtime), _hesults (hourly),  _desults (daily) values to zero,
-initializes I2C sensors and stores status of each sensor: _sensorStatus of 15 means NO sensors and sets "unplugged" flag
-"Unplugged" invokes random number generation in place of real values and will need to be disabled at some time soon.
+begin(): initializes the Sensors object: sets all _results (realtime) values to zero, empties the statistics,
+starts the I2C bus and initializes the sensors. A missing sensor is reported; its results stay at zero until it answers.
 parameters: none
-returns: int: the value of _sensorStatus
+returns: uint32_t: bit i set if sensor i (StationSensors order) is missing
 ***********************************************************************************************************/
-int Sensors::begin() {
-  bool bBMP, bAHT, bBHa, bBHb;
-  _results.temperature = 0;
-  _results.humidity = 0;
-  _results.pressure = 0;
-  _results.lightA = 0;
-  _results.lightB = 0;
-  Serial.println();
-  
-  // Initialise the four I2C sensors
-  Serial.print("Sensor status: ");
-  _sensorStatus = 0;
-  bBMP = _bmp.begin();
-  if (!bBMP) _sensorStatus = 1;
-  bAHT = _aht.begin();
-  if (!bAHT) _sensorStatus += 2;
-  bBHa = _bh1750a.begin();
-  if (!bBHa) _sensorStatus += 4;
-  bBHb = _bh1750b.begin(BH1750::CONTINUOUS_HIGH_RES_MODE, 0x5c);
-  if (!bBHb) _sensorStatus += 8;
-  return _sensorStatus;
+uint32_t Sensors::begin() {
+  memset(&_results, 0, sizeof(_results));
+  _tick = 0;
+  memset(_stepCy, 0, sizeof(_stepCy));
+  memset(_cycleCy, 0, sizeof(_cycleCy));
+  memset(_busTime, 0, sizeof(_busTime));
+  for (int i = 0; i < SENS_COUNT; i++) _hist[i].clear();
+  memset(_hesults, 0, sizeof(_hesults));
+  for (int i = 0; i < SENS_FIELDS; i++) {
+    _hourAcc[i].clear();
+    _dayAcc[i].clear();
+  }
+
+  halI2CBegin(I2C_HZ);
+  uint32_t missing = _set.begin();
+  char mBuf[BUF_LEN];
+  MsgWriter mw(mBuf, BUF_LEN);
+  mw.putStr(missing ? "Sensors missing:" : "Sensors: all present");
+  for (int i = 0; i < SENS_COUNT; i++) {
+    if ((missing & (1UL << i)) == 0) continue;
+    mw.put(' ');
+    mw.putStr(name(i));
+  }
+  halLog(mw.text());
+  return missing;
 }
 
 /********************************************************************************************************
-updateAHT(): The AHT sensor is read every 10 seconds (Zone40) and values stored in 2 _result fields (temperature and humidity)
+step(): runs this tick of every sensor's acquisition cycle (see SensorSet.h), records the bus time of those
+that used the bus and adds new readings to the hour's statistics. Called every tick; none of the steps waits
+for a conversion.
 parameters: none
-returns: boolean: true if actual results, false if random numbers
+returns: boolean: true if this tick had sensor work
 *********************************************************************************************************/
-bool Sensors::updateAHT() {
-  sensors_event_t humidity, temp;
-  bool rv = false;
-  if((_sensorStatus & 1) == 0) {
-    if (_aht.getEvent(&humidity, &temp)) {
-      _results.humidity = (int)(humidity.relative_humidity + 0.5f);  // round to int
-      _results.temperature = (int)(temp.temperature + 0.5f); // round to int
-      rv = true;
+bool Sensors::step() {
+  uint32_t fresh;
+  uint32_t ended = _set.step(_tick++, _results.v, _stepCy, &fresh);
+  bool worked = false;
+  int f = 0;  // the sensor's first field
+  for (int i = 0; i < SENS_COUNT; i++) {
+    if (fresh & (1UL << i)) {
+      for (int j = f; j < f + StationSensors::FIELDS_OF[i]; j++) _hourAcc[j].add(_results.v[j]);
+    }
+    f += StationSensors::FIELDS_OF[i];
+    if (_stepCy[i] != 0) {  // on the bus this step
+      worked = true;
+      _hist[i].record(_stepCy[i]);
+      unsigned long us = _stepCy[i] / halCyclesPerUs();
+      if (us > _busTime[i].maxUs) _busTime[i].maxUs = us;
+      _cycleCy[i] += _stepCy[i];
+    }
+    if (ended & (1UL << i)) {
+      _busTime[i].cycleUs = _cycleCy[i] / halCyclesPerUs();
+      _cycleCy[i] = 0;
     }
-  } else {    //do random stuff
-    unsigned long r = random(100);
-    _results.humidity = (int)r % 100;
-    _results.temperature = 5 + (int)r % 20;
-    rv = false;
   }
-  return rv;
+  return worked;
 }
 
-/***************************************************************************************************
-update BMP(): The BMP sensor is read every 10 seconds (Zone40) and values stored in _result field pressure
-parameters: none
-returns: boolean: true if actual results, false if random
-****************************************************************************************************/
-bool Sensors::updateBMP() {
-  float p;
-  if ((_sensorStatus & 2) == 0) {
-    _bmp.getPressure(&p);
-    _results.pressure = (int)(0.01f * p);
-    return true;
-  } else {
-    unsigned long r = random(40);
-    _results.pressure = 980 + (int)r;
-    return false;
+// AHT10/AHT20 (temperature and humidity) ------------------------------------------------------------------
+
+// begin(): soft reset, then calibration if the status byte does not show it (boot only: may wait)
+bool AhtSensor::begin() {
+  const byte reset = 0xBA;
+  const byte calibrate[] = { 0xBE, 0x08, 0x00 };
+  byte status;
+  if (!halI2CWrite(AHT_ADDR, &reset, 1)) return false;
+  halDelay(20);
+  if (!halI2CRead(AHT_ADDR, &status, 1)) return false;
+  if ((status & 0x08) == 0) {
+    if (!halI2CWrite(AHT_ADDR, calibrate, sizeof(calibrate))) return false;
+    halDelay(10);
   }
+  return true;
 }
 
 /********************************************************************************************************
-updateBH1750(): places the current readings of the light sensors in the _result struct: adapted for 2 light sensors
-parameters: none
-returns: byte: _sensorStatus & 12: values 0 (both real), 4 (A random, B real), 8 (A real, B random) or 12 (both random)
+step(): phase 0 triggers a measurement; phase 1 reads it (status, 20-bit humidity, 20-bit temperature in one
+6-byte burst)
+parameters:
+  phase: int: 0 or 1
+  out: int[2]: temperature, humidity (kept if the read fails)
+returns: int: SENS_BUS, plus SENS_NEW once read
 *********************************************************************************************************/
-byte Sensors::updateBH1750() {
-  float output;
-  
-  if ((_sensorStatus & 4) == 0) {
-    output = _bh1750a.readLightLevel();
-    if (output < 0) _results.lightA = 0;
-    else _results.lightA = (int)(13.0 * log(1.0f + output)); // may need rescaling
-  }
-  else {  // "random" mode
-    unsigned long r = random(100); // arbitrary shift
-    int ir = (int)r;
-    _results.lightA = ir;
+int AhtSensor::step(int phase, int* out) {
+  const byte trigger[] = { 0xAC, 0x33, 0x00 };
+  byte d[6];
+  if (phase == 0) {
+    halI2CWrite(AHT_ADDR, trigger, sizeof(trigger));
+    return SENS_BUS;
   }
-if ((_sensorStatus & 8) == 0) {
-    output = _bh1750b.readLightLevel();
-    if (output < 0) _results.lightB = 0;
-    else _results.lightB = (int)(13.0 * log(1.0f + output)); // may need rescaling
+  if (!halI2CRead(AHT_ADDR, d, sizeof(d)) || (d[0] & 0x80) != 0) return SENS_BUS;  // failed or busy
+  unsigned long rawH = ((unsigned long)d[1] << 12) | ((unsigned long)d[2] << 4) | (d[3] >> 4);
+  unsigned long rawT = ((unsigned long)(d[3] & 0x0f) << 16) | ((unsigned long)d[4] << 8) | d[5];
+  out[0] = convOutput(CONV_TEMPERATURE, convAhtTemperature(rawT));
+  out[1] = convOutput(CONV_HUMIDITY, convAhtHumidity(rawH));
+  return SENS_BUS | SENS_NEW;
+}
+
+// BMP085/BMP180 (pressure) ------------------------------------------------------------------------------
+
+// begin(): finds the chip and reads its calibration
+bool BmpSensor::begin() {
+  _b5 = 0;
+  _calOk = readCal();
+  return _calOk;
+}
+
+// readCal(): checks the chip id and reads the calibration EEPROM in one burst
+bool BmpSensor::readCal() {
+  byte id;
+  byte c[22];
+  if (!halI2CWriteRead(BMP_ADDR, 0xD0, &id, 1) || id != 0x55) return false;
+  if (!halI2CWriteRead(BMP_ADDR, 0xAA, c, sizeof(c))) return false;
+  uint16_t w[11];
+  for (int i = 0; i < 11; i++) w[i] = (uint16_t)((c[2 * i] << 8) | c[2 * i + 1]);
+  _cal.ac1 = (int16_t)w[0];
+  _cal.ac2 = (int16_t)w[1];
+  _cal.ac3 = (int16_t)w[2];
+  _cal.ac4 = w[3];
+  _cal.ac5 = w[4];
+  _cal.ac6 = w[5];
+  _cal.b1 = (int16_t)w[6];
+  _cal.b2 = (int16_t)w[7];
+  _cal.mb = (int16_t)w[8];
+  _cal.mc = (int16_t)w[9];
+  _cal.md = (int16_t)w[10];
+  return true;
+}
+
+/***************************************************************************************************
+step(): phase 0 starts a temperature conversion (ready after 4.5 ms); phase 1 reads it (kept as B5 for the
+pressure) and starts the pressure conversion (ready after 25.5 ms at OSS 3); phase 2 reads the pressure.
+Without the calibration (chip missing at boot) phase 0 looks for it instead.
+parameters:
+  phase: int: 0 to 2
+  out: int[1]: pressure, hPa (kept if the read fails)
+returns: int: SENS_BUS if the bus was used, plus SENS_NEW once the pressure is read
+****************************************************************************************************/
+int BmpSensor::step(int phase, int* out) {
+  const byte tempCmd[] = { 0xF4, 0x2E };
+  const byte pressCmd[] = { 0xF4, (byte)(0x34 + (BMP_OSS << 6)) };
+  byte d[3];
+  if (!_calOk) {
+    if (phase == 0) _calOk = readCal();
+    return phase == 0 ? SENS_BUS : 0;
   }
-  else {  // "random" mode
-    unsigned long r = random(100); // arbitrary shift
-    int ir = (int)r;
-    _results.lightB = ir;
+  switch (phase) {
+    case 0:
+      halI2CWrite(BMP_ADDR, tempCmd, sizeof(tempCmd));
+      break;
+    case 1:
+      if (halI2CWriteRead(BMP_ADDR, 0xF6, d, 2)) _b5 = b5(_cal, (d[0] << 8) | d[1]);
+      halI2CWrite(BMP_ADDR, pressCmd, sizeof(pressCmd));
+      break;
+    default:
+      if (halI2CWriteRead(BMP_ADDR, 0xF6, d, 3)) {
+        long up = (((long)d[0] << 16) | ((long)d[1] << 8) | d[2]) >> (8 - BMP_OSS);
+        out[0] = convOutput(CONV_PRESSURE, convPressure(pressure(_cal, _b5, up, BMP_OSS)));
+        return SENS_BUS | SENS_NEW;
+      }
+      break;
   }
+  return SENS_BUS;
+}
+
+/***************************************************************************************************
+b5(): BMP085 temperature compensation: the intermediate B5 (temperature in 0.1 C is (B5 + 8) / 16)
+parameters:
+  cal: the chip's calibration
+  ut: long: raw temperature
+returns: long: B5
+****************************************************************************************************/
+long BmpSensor::b5(const bmpCal& cal, long ut) {
+  long x1 = ((ut - (long)cal.ac6) * (long)cal.ac5) >> 15;
+  long x2 = ((long)cal.mc << 11) / (x1 + cal.md);
+  return x1 + x2;
+}
+
+/***************************************************************************************************
+pressure(): BMP085 pressure compensation (datasheet integer algorithm)
+parameters:
+  cal: the chip's calibration
+  b5: long: from b5()
+  up: long: raw pressure
+  oss: int: oversampling setting of the conversion (0-3)
+returns: long: pressure (Pa)
+****************************************************************************************************/
+long BmpSensor::pressure(const bmpCal& cal, long b5, long up, int oss) {
+  long b6 = b5 - 4000;
+  long x1 = (cal.b2 * ((b6 * b6) >> 12)) >> 11;
+  long x2 = (cal.ac2 * b6) >> 11;
+  long x3 = x1 + x2;
+  long b3 = ((((long)cal.ac1 * 4 + x3) << oss) + 2) / 4;
+  x1 = (cal.ac3 * b6) >> 13;
+  x2 = (cal.b1 * ((b6 * b6) >> 12)) >> 16;
+  x3 = ((x1 + x2) + 2) >> 2;
+  unsigned long b4 = ((unsigned long)cal.ac4 * (unsigned long)(x3 + 32768)) >> 15;
+  unsigned long b7 = ((unsigned long)up - b3) * (unsigned long)(50000UL >> oss);
+  long p = (b7 < 0x80000000UL) ? (long)((b7 * 2) / b4) : (long)((b7 / b4) * 2);
+  x1 = (p >> 8) * (p >> 8);
+  x1 = (x1 * 3038) >> 16;
+  x2 = (-7357 * p) >> 16;
+  return p + ((x1 + x2 + 3791) >> 4);
+}
 
-  return (byte)_sensorStatus & 12;
+// BH1750 (light) ---------------------------------------------------------------------------------------
+
+// bhBegin(): power on and continuous high resolution mode (1 lx, new result every 120 ms)
+bool bhBegin(byte addr) {
+  const byte powerOn = 0x01;
+  const byte mode = 0x10;
+  return halI2CWrite(addr, &powerOn, 1) && halI2CWrite(addr, &mode, 1);
+}
+
+/********************************************************************************************************
+bhRead(): reads the latest continuous-mode result of one BH1750: one 2-byte burst
+parameters:
+  addr: byte: its I2C address
+  channel: int: its CONV_ calibration
+  out: int*: receives the light level (13 ln(1 + lux), calibrated), 0 if the read fails
+returns: boolean: true if read
+*********************************************************************************************************/
+bool bhRead(byte addr, int channel, int* out) {
+  byte d[2];
+  if (!halI2CRead(addr, d, sizeof(d))) {
+    *out = 0;
+    return false;
+  }
+  *out = convOutput(channel, convLight((uint16_t)((d[0] << 8) | d[1])));
+  return true;
 }
 
 /****************************************************************************************************
-makeCSV(): realtime and hourly CSV results to buf
+makeCSV(): appends realtime or hourly results as CSV to a message (layout CSV_SENS)
 parameters:
   vals: sens structure containing realtime or hourly results
-  buf: char* character buffer address to receive CSV
-returns: boolean: always true
+  mw: MsgWriter&: the message being built
+returns: void
 *****************************************************************************************************/
-bool Sensors::makeCSV(sens vals, char *buf) {
-  sprintf(buf, ",%04d,%04d,%04d,%04d,%04d,", vals.temperature, vals.humidity, vals.pressure, vals.lightA, vals.lightB);
-  return true;
+void Sensors::makeCSV(const sens& vals, MsgWriter& mw) {
+  mw.putCSV(CSV_SENS, vals.v);
 }
 
 /****************************************************************************************************
-getCSVRT(): put RT values into designated buffer buf
-parameters: buf: char* character buffer address to receive CSV
+getCSVRT(): appends the RT values as CSV to a message
+parameters: mw: MsgWriter&: the message being built
 returns: void
 *****************************************************************************************************/
-void Sensors::getCSVRT(char* buf) {
-  makeCSV(_results, buf);
+void Sensors::getCSVRT(MsgWriter& mw) {
+  makeCSV(_results, mw);
 }
 
 /***************************************************************************************************
-storeHrResults(): method to copy realtime values into relevant day and hour array element
+storeHrResults(): ends an hour: its statistics (mean, minimum, maximum of the readings taken in it) go into
+the hour's array element and are merged into the day's. A field without a reading in the hour (sensor
+missing) gets its realtime value.
 parameters:
   hr: int hour (0-23)
 returns: void
 ****************************************************************************************************/
 void Sensors::storeHrResults(int hr) {
-  // Simply re-use realtime figures for all sensors
-  _hesults[hr].temperature = _results.temperature;
-  _hesults[hr].humidity = _results.humidity;
-  _hesults[hr].pressure = _results.pressure;
-  _hesults[hr].lightA = _results.lightA;
-  _hesults[hr].lightB = _results.lightB;
+  sensHr& h = _hesults[hr];
+  for (int i = 0; i < SENS_FIELDS; i++) {
+    Accum& a = _hourAcc[i];
+    bool read = a.count() > 0;
+    h.mean.v[i] = read ? a.mean() : _results.v[i];
+    h.lo.v[i] = read ? a.min() : _results.v[i];
+    h.hi.v[i] = read ? a.max() : _results.v[i];
+    _dayAcc[i].merge(a);
+    a.clear();
+  }
+}
+
+/***************************************************************************************************
+takeDay(): ends a day: hands over the statistics of the readings in its completed hours and starts the next
+parameters: sd: sensDay* to receive them (fields without a reading in the day are 0)
+returns: void
+****************************************************************************************************/
+void Sensors::takeDay(sensDay* sd) {
+  for (int i = 0; i < SENS_FIELDS; i++) {
+    Accum& a = _dayAcc[i];
+    sd->mean.v[i] = a.mean();
+    sd->lo.v[i] = a.min();
+    sd->hi.v[i] = a.max();
+    sd->sd.v[i] = a.sd();
+    a.clear();
+  }
 }
 
 /************************************************************************************************
-getCSVHour(): formats hourly values as CSV and places into character buffer
+getCSVHour(): appends an hour's mean values as CSV to a message
 parameters:
-  dy: int day (1-31)
   hr: int (0-23)
-  buf: char* character buffer address
+  mw: MsgWriter&: the message being built
 returns: void
 *************************************************************************************************/
-void Sensors::getCSVHour(int hr, char* buf) {
-  makeCSV(_results, buf); // NB: hourly sensors data are just the realtime values
+void Sensors::getCSVHour(int hr, MsgWriter& mw) {
+  makeCSV(_hesults[hr].mean, mw);
 }
@@ -1,49 +1,164 @@
 #ifndef SENSORS_H
 #define SENSORS_H
 
-#include "Arduino.h"
+#include "Hal.h"
+#include "Config.h"
+#include "LatHist.h"
+#include "Accum.h"
+#include "MsgWriter.h"
+#include "SensorSet.h"
+#include "SensConv.h"
 
-#include <Wire.h>
-#include <Adafruit_BMP085_U.h>
-#include <Adafruit_AHTX0.h>
-#include <BH1750.h>
+#define MIN_BAR 0.05
+
+// I2C addresses
+#define AHT_ADDR 0x38
+#define BMP_ADDR 0x77
+#define BHA_ADDR 0x23
+#define BHB_ADDR 0x5c
+
+// BMP085 factory calibration (EEPROM 0xAA-0xBF, big-endian)
+struct bmpCal {
+  int16_t ac1, ac2, ac3;
+  uint16_t ac4, ac5, ac6;
+  int16_t b1, b2, mb, mc, md;
+};
+
+// Structure holding one sensor's I2C bus time
+struct busTime {
+  unsigned long cycleUs;  // all of the sensor's transactions in the last acquisition cycle
+  unsigned long maxUs;  // longest single step (one tick's transactions)
+};
+
+// ----------------------------------------------------------------------------------------------------------
+// Sensor drivers (see SensorSet.h): split-phase, so no tick waits for a conversion. Reads are single burst
+// transactions on a fast-mode (I2C_HZ) bus.
+
+// AHT10/AHT20 (temperature and humidity): triggered on phase 0, read on phase 1 (ready after 80 ms)
+class AhtSensor {
+  public:
+  static constexpr const char* NAME = "aht";
+  static constexpr int FIELDS = 2;
+  static constexpr sensField FIELD[FIELDS] = { { { 4, 3, true }, 2 }, { { 4, 3, false }, 1 } };  // C, %RH
+  static constexpr int PERIOD = SENS_CYCLE;
+  static constexpr int PHASES = 2;
+  bool begin();
+  int step(int phase, int* out);
+};
+
+// BMP085/BMP180 (pressure): temperature conversion started on phase 0, read on phase 1 (which starts the
+// pressure conversion, OSS 3), pressure read on phase 2
+class BmpSensor {
+  public:
+  static constexpr const char* NAME = "bmp";
+  static constexpr int FIELDS = 1;
+  static constexpr sensField FIELD[FIELDS] = { { { 4, 4, false }, 2 } };  // hPa
+  static constexpr int PERIOD = SENS_CYCLE;
+  static constexpr int PHASES = 3;
+  bool begin();
+  int step(int phase, int* out);
+
+  // BMP085 compensation (datasheet integer algorithm): public for the host check (host/BmpCheck.cpp)
+  static long b5(const bmpCal& cal, long ut);
+  static long pressure(const bmpCal& cal, long b5, long up, int oss);
+
+  private:
+  bool readCal();
+
+  bmpCal _cal;
+  bool _calOk;  // calibration read (a BMP missing at boot is looked for again each cycle)
+  long _b5;
+};
+
+// BH1750 (light), one per address: continuous high resolution mode (always ready), read on phase 2
+bool bhBegin(byte addr);
+bool bhRead(byte addr, int channel, int* out);
+
+template <byte ADDR, int CHANNEL, char ID> class BhSensor {
+  public:
+  static constexpr char NAME[] = { 'b', 'h', ID, '\0' };
+  static constexpr int FIELDS = 1;
+  static constexpr sensField FIELD[FIELDS] = { { { 4, 3, false }, 1 } };  // 13 ln(1 + lux)
+  static constexpr int PERIOD = SENS_CYCLE;
+  static constexpr int PHASES = 3;
+  bool begin() { return bhBegin(ADDR); }
+  int step(int phase, int* out) {
+    if (phase != PHASES - 1) return 0;
+    return bhRead(ADDR, CHANNEL, out) ? SENS_BUS | SENS_NEW : SENS_BUS;
+  }
+};
+
+// The station's sensors, in the order of their fields in every message, frame and record: add a sensor here
+// (with its conversion's CONV_CAL entry), nothing else changes by hand
+typedef SensorSet<AhtSensor, BmpSensor, BhSensor<BHA_ADDR, CONV_LIGHTA, 'a'>, BhSensor<BHB_ADDR, CONV_LIGHTB, 'b'>>
+  StationSensors;
 
+constexpr int SENS_COUNT = StationSensors::SENSORS;
+constexpr int SENS_FIELDS = StationSensors::FIELDS;  // temperature, humidity, pressure, lightA, lightB
+static constexpr const csvField (&CSV_SENS)[SENS_FIELDS] = StationSensors::LAYOUT.csv;
+static constexpr const uint8_t (&SENS_BYTES)[SENS_FIELDS] = StationSensors::LAYOUT.bytes;
+constexpr int sensFrameLen() {
+  int len = 0;
+  for (int i = 0; i < SENS_FIELDS; i++) len += SENS_BYTES[i];
+  return len;
+}
+constexpr int SENS_FRAME_LEN = sensFrameLen();  // sensor bytes in the binary frame
+
+constexpr int RT_CSV_LEN = csvLen(CSV_RW_RT) + csvLen(CSV_SENS) + csvLen(CSV_BATT);  // 'R' fields
+constexpr int HR_CSV_LEN = csvLen(CSV_RW_HR) + csvLen(CSV_SENS) + csvLen(CSV_BATT);  // 'H' fields
+constexpr int DAY_CSV_LEN = ULONG_LEN + csvLen(CSV_DAY) + 4 * csvLen(CSV_SENS) + 3 * csvLen(CSV_BATT);  // 'D' fields
+
+// Structure holding the sensors' results, in StationSensors order
 struct sens {
-  int temperature;
-  int humidity;
-  int pressure;
-  int lightA;
-  int lightB;
+  int v[SENS_FIELDS];
 };
 
-#define MIN_BAR 0.05
+// Structure holding one hour's sensor statistics, over the readings taken in the hour
+struct sensHr {
+  sens mean;
+  sens lo;  // minimum
+  sens hi;  // maximum
+};
+
+// Structure holding one day's sensor statistics, rolled up from its hours
+struct sensDay {
+  sens mean;
+  sens lo;
+  sens hi;
+  sens sd;  // standard deviation
+};
 
 // ----------------------------------------------------------------------------------------------------------
+// Sensors: runs the StationSensors acquisition (step() every tick), keeps the realtime results and records each
+// sensor's bus time per step in a latency histogram. Every new reading goes into an Accum per field; at the end
+// of an hour they give the hour's mean, minimum and maximum and are merged into the day's.
 
 class Sensors {
   public:
   Sensors();
-  int begin();
-  bool updateAHT();
-  bool updateBMP();
-  byte updateBH1750();
-  void getCSVRT(char* buf);
-  void getCSVHour(int hr, char* buf);
+  uint32_t begin();
+  bool step();
+  void getCSVRT(MsgWriter& mw);
+  sens getResults() { return _results; }
+  void getCSVHour(int hr, MsgWriter& mw);
   void storeHrResults(int hr);
+  sensHr getHrResults(int hr) { return _hesults[hr]; }
+  void takeDay(sensDay* sd);
+  const busTime& timing(int ix) { return _busTime[ix]; }
+  LatHist& hist(int ix) { return _hist[ix]; }
+  static const char* name(int ix) { return StationSensors::NAMES[ix]; }
+  static void makeCSV(const sens& vals, MsgWriter& mw);
 
   private:
-  // Nested classes
-  Adafruit_AHTX0 _aht;
-  Adafruit_BMP085_Unified _bmp;
-  BH1750 _bh1750a;
-  BH1750 _bh1750b;  
-  
-  bool makeCSV(sens vals, char *buf);
-
-  unsigned long int _prevTime;
-  int _sensorStatus;  
+  StationSensors _set;
+  unsigned long _tick;
+  uint32_t _stepCy[SENS_COUNT];  // bus time (cycles) of each sensor in the current step
+  uint32_t _cycleCy[SENS_COUNT];  // and in the current cycle
+  busTime _busTime[SENS_COUNT];
+  LatHist _hist[SENS_COUNT];
   sens _results;
-  sens _hesults[HPD];
-
+  sensHr _hesults[HPD];
+  Accum _hourAcc[SENS_FIELDS];  // readings in the current hour
+  Accum _dayAcc[SENS_FIELDS];  // and in the current day's completed hours
 };
-#endif
\ No newline at end of file
+#endif
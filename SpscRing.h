@@ -0,0 +1,51 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "Hal.h"
+#include <atomic>
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// SpscRing: lock-free single-producer / single-consumer ring buffer.
+// The producer (e.g. an ISR) only writes _head, the consumer only writes _tail, so neither side needs to
+// disable interrupts or take a lock. N must be a power of two; the ring holds up to N items.
+// A push onto a full ring is refused and counted in overflows().
+
+template <typename T, unsigned int N>
+class SpscRing {
+  static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+  public:
+  SpscRing() : _head(0), _tail(0), _overflows(0) {};
+
+  // Producer side
+  bool ICACHE_RAM_ATTR push(const T& item) {
+    unsigned int head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= N) {
+      _overflows.store(_overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    _buf[head & (N - 1)] = item;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool pop(T* item) {
+    unsigned int tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) return false;
+    *item = _buf[tail & (N - 1)];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  unsigned int size() { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+  unsigned int overflows() { return _overflows.load(std::memory_order_relaxed); }
+
+  private:
+  T _buf[N];
+  std::atomic<unsigned int> _head;
+  std::atomic<unsigned int> _tail;
+  std::atomic<unsigned int> _overflows;
+};
+
+#endif
@@ -0,0 +1,839 @@
+#include "Config.h"
+#include "Hal.h"
+#include "Station.h"
+
+// ------------------------------ Version of 17/10/2026 ---------------------------------
+// Station class holds everything RoofBB.ino used to do inside loop(): the sampling (through Sampler), the CSV
+// messages and the Shed request handling. It reaches the hardware and the MQTT client only through Hal.h,
+// so the same code runs on the roof and in the host build.
+// Every CSV message is built in place, in the buffer it is published from, by one MsgWriter pass; the worst case of
+// each message (all fields at their widest) is checked against its buffer here:
+static_assert(1 + RT_CSV_LEN < BUF_LEN, "'R' message does not fit BUF_LEN");
+static_assert(1 + 2 * ULONG_LEN + 1 + HR_CSV_LEN < BUF_LEN, "'H'/'K' message does not fit BUF_LEN");
+static_assert(1 + ULONG_LEN + BATCH_MAX * (1 + ULONG_LEN + RT_CSV_LEN + CAPTURE_CSV_LEN) < BATCH_BUF_LEN,
+  "'B' message does not fit BATCH_BUF_LEN");
+
+/*********************************************************************************************************
+holdDay(): keeps a day whose post failed, to be posted again by serviceDays(): the oldest goes if DAY_HELD_LEN
+are already held
+parameters:
+  held: the days held (block day numbers or 'D' statistics), oldest first
+  n: int*: how many
+  item: the day to add
+returns: void
+**********************************************************************************************************/
+template <typename T> static void holdDay(T* held, int* n, const T& item) {
+  if (*n == DAY_HELD_LEN) {
+    halLog("Day held too long: dropped");
+    memmove(held, held + 1, (DAY_HELD_LEN - 1) * sizeof(T));
+    (*n)--;
+  }
+  held[(*n)++] = item;
+}
+
+// releaseDay(): forgets the oldest day held, once posted
+template <typename T> static void releaseDay(T* held, int* n) {
+  (*n)--;
+  memmove(held, held + 1, *n * sizeof(T));
+}
+
+Station::Station() {};
+
+/*********************************************************************************************************
+begin(): initiates the Station object: starts the clock and its SNTP resyncs, the Sampler (sensors and rain/wind
+detectors), the history log and the network side's state
+parameters: unix2k: time from internet (seconds since 1/1/2000), 0 if unknown
+returns: void
+**********************************************************************************************************/
+void Station::begin(unsigned long unix2k) {
+  _timebase.begin(unix2k);  // 0: time since boot until SNTP sets it
+  _bootShift = 0;
+  _sampler.begin(_timebase);
+  _chrono.begin(_timebase);
+  if (!halTimeSyncBegin(NTP_SERVER, CLOCK_SYNC_SECS)) halLog("SNTP resync unavailable");
+  if (!_histLog.begin(halFsRoot())) halLog("History log unavailable");
+  memset(_recentHours, 0, sizeof(_recentHours));
+  _volts = 0;
+  _framesDropped = 0;
+  _mqtt.begin();
+  if (!_forward.begin(FWD_SAMPLES)) halLog("Store-and-forward unavailable");
+  _lastForward = halMillis();
+  _numBlocksHeld = 0;
+  _numStatsHeld = 0;
+  _bootMessage = NULL;
+  _pubHist.clear();
+  _mqttHist.clear();
+  _netHist.clear();
+  _frameMode = FRAME_MODE_CSV;
+  _csvVersion = CSV_VERSION;
+  _trace = false;
+  _batch.begin(0, BATCH_SECS);  // batching off until the Shed asks for it
+  _bNewMessage = false;
+  // Start with a nice empty i/c Buffer
+  flushICBuffer();
+}
+
+/*********************************************************************************************************
+startTasks(): starts the sampling task on SAMPLE_CORE and the network task on NET_CORE (ESP32). From then on
+nothing else may call tick(), netTick() or the MQTT client.
+parameters: none
+returns: boolean: true if both tasks were started
+**********************************************************************************************************/
+bool Station::startTasks() {
+  return halStartTask("sample", sampleTask, this, SAMPLE_CORE, SAMPLE_PRIORITY)
+    && halStartTask("net", netTask, this, NET_CORE, NET_PRIORITY);
+}
+
+// Task bodies: the sampling task keeps the LOOP_TIME deadlines; the network task may block (e.g. reconnecting)
+void Station::sampleTask(void* arg) {
+  Station* st = (Station*)arg;
+  for (;;) {
+    st->_sampler.tick();
+    st->_sampler.waitForNextTick();
+  }
+}
+
+void Station::netTask(void* arg) {
+  Station* st = (Station*)arg;
+  for (;;) {
+    unsigned long start = halMillis();
+    st->netTick();
+    halSleepUntil(start + NET_TICK_MS);
+  }
+}
+
+/*********************************************************************************************************
+tick(): single-task alternative to startTasks() (host build): one loop of sampling followed by one pass of
+the network side
+parameters: none
+returns: byte: activity flag (sampling jobs' flags plus the network side's)
+**********************************************************************************************************/
+byte Station::tick() {
+  byte actFlag = _sampler.tick();
+  return actFlag + netTick();
+}
+
+/*********************************************************************************************************
+waitForNextTick(): sleeps until the next sampling tick is due (LOOP_TIME after the previous one)
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Station::waitForNextTick() {
+  _sampler.waitForNextTick();
+}
+
+/*********************************************************************************************************
+netTick(): one pass of the network side: one step of the MQTT connection state machine, the client loop,
+the samples, hours and messages queued by the Sampler, a batch of samples held during an outage, any Shed
+request and then, in the time left, any range catch-up in progress. Nothing here waits for the broker.
+parameters: none
+returns: byte: activity flag (4 if the Shed asked for hourly data, 16 if catch-up posted, 32 if MQTT is down)
+**********************************************************************************************************/
+byte Station::netTick() {
+  byte actFlag = 0;
+  uint32_t startCy = halCycles();
+  unsigned long tickStart = halMillis();
+  if (_mqtt.step() != MQ_CONNECTED) {
+    actFlag += 32;
+  }
+  else {
+    mqttLoop();
+    if (_mqtt.justConnected()) postLinkStats();
+  }
+  serviceClock();
+  drainQueues();
+  serviceForward();  // after the live samples
+  serviceDays();
+
+  // CHECK IF SHED WANTS DATA:
+  hdc hd1 = shedRequested();
+  if (hd1.day != 0) {  // by Shed
+    char mBuf[BUF_LEN];
+    sprintf(mBuf, "Shed req%c%d:%d", hd1.hdr, hd1.day, hd1.hour);
+    halLog(mBuf);
+    postHour(hd1);
+    actFlag += 4;
+  }
+  if (serviceCatchUp(tickStart)) actFlag += 16;
+  _netHist.record(halCycles() - startCy);
+  return actFlag;
+}
+
+/*********************************************************************************************************
+drainQueues(): takes everything the Sampler has queued: messages are posted, completed hours logged, completed
+days' statistics, closed latency statistics periods and realtime frames posted (or batched)
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Station::drainQueues() {
+  msgRec msg;
+  while (_sampler.popMessage(&msg)) postMessage(msg.text);
+  histRec rec;
+  while (_sampler.popHour(&rec)) storeHour(rec);
+  dayRec day;
+  while (_sampler.popDay(&day)) {
+    if (!postDayStats(day)) holdDay(_statsHeld, &_numStatsHeld, day);
+  }
+  statPeriod sp;
+  while (_sampler.popStats(&sp)) postStats(sp);
+  rtFrame fr;
+  while (_sampler.popFrame(&fr)) postRT(fr);
+  unsigned int dropped = _sampler.framesDropped();
+  if (dropped != _framesDropped) {
+    char mBuf[BUF_LEN];
+    sprintf(mBuf, "Realtime samples dropped: %u", dropped);
+    postMessage(mBuf);
+    _framesDropped = dropped;
+  }
+}
+
+/*********************************************************************************************************
+postLinkStats(): posts the MQTT connection metrics (and, the first time, the boot message) when the link
+comes up
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Station::postLinkStats() {
+  char mBuf[BUF_LEN];
+  const mqttStats& ms = _mqtt.stats();
+  if (_bootMessage) {
+    postMessage(_bootMessage);
+    _bootMessage = NULL;
+  }
+  sprintf(mBuf, "MQTT up after %lu ms; longest %lu ms; attempts %lu; fails %lu; drops %lu", ms.lastDownMs, ms.maxDownMs,
+    ms.attempts, ms.failures, ms.drops);
+  postMessage(mBuf);
+  sprintf(mBuf, "Samples held: %d; dropped: %lu", _forward.count(), _forward.dropped());
+  postMessage(mBuf);
+}
+
+/*********************************************************************************************************
+postStats(): posts a statistics period closed by the Sampler on ws/stats, with the network side's own over the
+same period, and starts the network side's next period:
+"S<secs>;<name>,<count>,<p50>,<p99>,<max>;...;ovh,<probes>,<cycles per probe>,<ppm>" (times in microseconds):
+the Sampler's summaries (tick, each job, each sensor's bus time), the network side's ("pub": each publish,
+"mqtt": client loop, "net": whole network tick), then the instrumentation's cost: probes in the period, cycles
+per probe and probe time in parts per million of the loop budget
+parameters: sp: statPeriod from the Sampler
+returns: void
+**********************************************************************************************************/
+void Station::postStats(const statPeriod& sp) {
+  char buf[STATS_BUF_LEN];
+  statRec recs[1 + SCHED_MAX_JOBS + SENS_COUNT + 3];
+  int n = 0;
+  for (int i = 0; i < sp.n; i++) recs[n++] = sp.recs[i];
+  _pubHist.summary("pub", &recs[n++]);
+  _mqttHist.summary("mqtt", &recs[n++]);
+  _netHist.summary("net", &recs[n++]);
+  _pubHist.clear();
+  _mqttHist.clear();
+  _netHist.clear();
+  int len = sprintf(buf, "S%d", STATS_SECS);
+  for (int i = 0; i < n && len < STATS_BUF_LEN - 64; i++) {
+    len += sprintf(buf + len, ";%s,%lu,%lu,%lu,%lu", recs[i].name, (unsigned long)recs[i].count,
+      (unsigned long)recs[i].p50, (unsigned long)recs[i].p99, (unsigned long)recs[i].max);
+  }
+  snprintf(buf + len, STATS_BUF_LEN - len, ";ovh,%lu,%lu,%lu", (unsigned long)sp.ovh.probes, (unsigned long)sp.ovh.probeCy,
+    (unsigned long)sp.ovh.ppm);
+  publish("ws/stats", buf);
+}
+
+/*********************************************************************************************************
+serviceClock(): disciplines the Timebase with the latest SNTP sync, if any, and reports the offset found and the
+drift estimate. If the station started without the time, the first sync sets it: the batch, stamped in seconds
+since boot, goes out as it is; the samples still held for store-and-forward are back-dated, and so are those
+still queued (see postRT()).
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Station::serviceClock() {
+  uint64_t mono, refUs;
+  _timebase.service();
+  if (!halTimeSample(&mono, &refUs)) return;
+  unsigned long before = _timebase.now();
+  bool stepped = _timebase.discipline(mono, refUs);
+  const clockStats& cs = _timebase.stats();
+  char mBuf[BUF_LEN];
+  if (before < TIME_VALID_2K && _timebase.now() >= TIME_VALID_2K) {
+    flushBatch();  // one message does not mix the two kinds of stamp (failing, it is held and back-dated below)
+    _bootShift = _timebase.now() - before;
+    sprintf(mBuf, "Time set at %lu s after boot: %d samples back-dated", before, _forward.redate(TIME_VALID_2K,
+      _bootShift));
+    postMessage(mBuf);
+  }
+  sprintf(mBuf, "Clock %s %ld us; drift %ld ppb; syncs %lu", stepped ? "stepped" : "slewing", cs.offsetUs,
+    cs.driftPpb, cs.syncs);
+  postMessage(mBuf);
+}
+
+/*********************************************************************************************************
+publish(), mqttLoop(): the MQTT client calls, timed into the network side's latency histograms
+**********************************************************************************************************/
+bool Station::publish(const char* topic, const char* payload) {
+  uint32_t t0 = halCycles();
+  bool ok = halPublish(topic, payload);
+  _pubHist.record(halCycles() - t0);
+  return ok;
+}
+
+bool Station::publish(const char* topic, const byte* payload, unsigned int length) {
+  uint32_t t0 = halCycles();
+  bool ok = halPublish(topic, payload, length);
+  _pubHist.record(halCycles() - t0);
+  return ok;
+}
+
+void Station::mqttLoop() {
+  uint32_t t0 = halCycles();
+  halMqttLoop();
+  _mqttHist.record(halCycles() - t0);
+}
+
+/*********************************************************************************************************
+storeHour(): keeps an hour just ended in the history log and in the last day's hours. The last hour of a day
+completes it: the day is then posted as a compressed block on ws/day (or held, if the broker is down)
+parameters: rec: histRec: the hour's results
+returns: void
+**********************************************************************************************************/
+void Station::storeHour(const histRec& rec) {
+  _recentHours[rec.hour2k % HPD] = rec;
+  if (!_histLog.append(rec)) halLog("History log append failed");
+  if (rec.hour2k % HPD == HPD - 1 && !postDay(rec.hour2k / HPD)) {
+    holdDay(_blocksHeld, &_numBlocksHeld, rec.hour2k / HPD);
+  }
+}
+
+/*********************************************************************************************************
+serviceDays(): posts again, oldest first, the ws/day blocks and 'D' messages that failed while the broker was
+down: one of each per network tick
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Station::serviceDays() {
+  if (!_mqtt.connected()) return;
+  if (_numBlocksHeld > 0 && postDay(_blocksHeld[0])) releaseDay(_blocksHeld, &_numBlocksHeld);
+  if (_numStatsHeld > 0 && postDayStats(_statsHeld[0])) releaseDay(_statsHeld, &_numStatsHeld);
+}
+
+/*********************************************************************************************************
+postHour(): posts the hourly results asked for by the Shed ('H' CSV), from the history log if it has them,
+otherwise from the last day's hours kept in RAM if that hour is the one asked for; else "no data" on ws/messages
+(or a rejection if the month has no such date)
+parameters: hd: hdc structure (day and hour requested)
+returns: void
+**********************************************************************************************************/
+void Station::postHour(const hdc& hd) {
+  uint32_t hour2k = _chrono.hourStamp(hd.day, hd.hour);
+  if (hour2k == NO_HOUR_STAMP) {
+    postMessage("Shed request rejected: no such day in the month");
+    return;
+  }
+  histRec rec;
+  if (!_histLog.find(hour2k, &rec)) {
+    if (_recentHours[hd.hour % HPD].hour2k != hour2k) {
+      char mBuf[BUF_LEN];
+      sprintf(mBuf, "Hour %lu: no data", (unsigned long)hour2k);
+      postMessage(mBuf);
+      return;
+    }
+    rec = _recentHours[hd.hour % HPD];
+  }
+  MsgWriter mw(_rtBuf, BUF_LEN);
+  mw.put('H');
+  RainWind::makeCSVHr(csvHour(rec.rw), mw);
+  Sensors::makeCSV(rec.s.mean, mw);
+  postCSV(mw);
+}
+
+/*********************************************************************************************************
+postDay(): posts one day's hourly records as a single compressed columnar block on ws/day (see DayCodec.h),
+for bulk export: the hours come from the history log, or from the last day's hours kept in RAM
+parameters: day2k: uint32_t: days since 1/1/2000
+returns: boolean: false if the block could not be published (worth trying again), true otherwise
+**********************************************************************************************************/
+bool Station::postDay(uint32_t day2k) {
+  dayRecs& d = _day;
+  d.day2k = day2k;
+  d.present = 0;
+  for (int h = 0; h < HPD; h++) {
+    uint32_t hour2k = day2k * HPD + h;
+    if (!_histLog.find(hour2k, &d.hours[h])) {
+      if (_recentHours[h].hour2k != hour2k) continue;
+      d.hours[h] = _recentHours[h];
+    }
+    d.present |= 1UL << h;
+  }
+  char mBuf[BUF_LEN];
+  if (d.present == 0) {
+    sprintf(mBuf, "Day %lu: no hours held", (unsigned long)day2k);
+    postMessage(mBuf);
+    return true;
+  }
+  int len = encodeDay(d, _dayBuf, DAY_BLOCK_MAX);
+  if (len == 0) {
+    sprintf(mBuf, "Day %lu: block too large", (unsigned long)day2k);
+    postMessage(mBuf);
+    return true;
+  }
+  mqttLoop();
+  return publish("ws/day", _dayBuf, len);
+}
+
+/*********************************************************************************************************
+postDayStats(): posts a day's statistics, rolled up by the Sampler from its hours, as a 'D' CSV message:
+"D<day>,<hours>,<buckets>,<bucketsHi>", then the sensors' means, minima, maxima and standard deviations
+(each in CSV_SENS layout), then the battery's mean, minimum and maximum
+parameters: d: dayRec: the day's statistics
+returns: boolean: true if posted
+**********************************************************************************************************/
+bool Station::postDayStats(const dayRec& d) {
+  char buf[DAY_CSV_LEN + 2];
+  MsgWriter mw(buf, sizeof(buf));
+  const int day[] = { d.hours, d.buckets, d.bucketsHi };
+  const int batt[][1] = { { d.batt.mean }, { d.batt.lo }, { d.batt.hi } };
+  mw.put('D');
+  mw.putUInt(d.day2k);
+  mw.putCSV(CSV_DAY, day);
+  Sensors::makeCSV(d.s.mean, mw);
+  Sensors::makeCSV(d.s.lo, mw);
+  Sensors::makeCSV(d.s.hi, mw);
+  Sensors::makeCSV(d.s.sd, mw);
+  for (int i = 0; i < 3; i++) mw.putCSV(CSV_BATT, batt[i]);
+  mqttLoop();
+  return publish("ws/csv", mw);
+}
+
+/********************************************************************************************************************
+onShedMessage(): stores an i/c MQTT message from the Shed for shedRequested() to pick up
+parameters:
+  message: byte array (ASCII) with message
+  length: i/c message length
+returns: void
+*********************************************************************************************************************/
+void Station::onShedMessage(const byte* message, unsigned int length) {
+  if (length >= QT_LEN) length = QT_LEN - 1;
+  _icLength = length;
+  for (unsigned int i = 0; i < length; i++) {
+    _bqticBuf[i] = message[i];
+  }
+  _bNewMessage = true;
+}
+
+/********************************************************************************************************************
+postCSV(): completes a CSV message with the battery field and posts it
+parameters:
+  mw: MsgWriter&: the message so far: header char and "raw" values
+returns: boolean: true if posted
+*********************************************************************************************************************/
+bool Station::postCSV(MsgWriter& mw) {
+  const long v[] = { (long)(_csvVersion == 1 ? rawVolts(_volts) : _volts) };  // battery
+  mw.putCSV(CSV_BATT, v);
+  mqttLoop();
+  bool ok = publish("ws/csv", mw);
+  const char* text = mw.text();
+  if (ok && text[0] != 'R' && text[0] != 'K') {
+    char mBuf[BUF_LEN + 12];
+    sprintf(mBuf, "Published: %s", text);
+    halLog(mBuf);
+  }
+  return ok;
+}
+
+/********************************************************************************************************************
+csvFrame(): a realtime sample with its wind direction and battery in the units of the CSV version (see CSV_VERSION)
+parameters: fr: rtFrame holding the sample (current units)
+returns: rtFrame: the sample to write as CSV
+*********************************************************************************************************************/
+rtFrame Station::csvFrame(const rtFrame& fr) {
+  rtFrame out = fr;
+  if (_csvVersion == 1) {
+    out.wd = fr.wd == NUL_WD ? NUL_WD_V1 : (WD_NORTH_RAW + (fr.wd * 4096 + 180) / 360) & 4095;
+    out.volts = rawVolts(fr.volts);
+  }
+  return out;
+}
+
+/********************************************************************************************************************
+csvHour(): an hour's rain and wind results with the wind direction in the units of the CSV version
+parameters: rw: wrHr (current units)
+returns: wrHr: the results to write as CSV
+*********************************************************************************************************************/
+wrHr Station::csvHour(const wrHr& rw) {
+  wrHr out = rw;
+  if (_csvVersion == 1) out.wdHr = NUL_WD_V1;
+  return out;
+}
+
+/********************************************************************************************************************
+rawVolts(): the raw battery reading (0-4095) that Sampler::checkBattery() turns into a battery voltage: the lowest
+one that reaches it, found by bisection of the ADC calibration
+parameters: centivolts: int: battery voltage
+returns: int: raw reading
+*********************************************************************************************************************/
+int Station::rawVolts(int centivolts) {
+  int lo = 0, hi = 4095;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if ((long)halAdcMillivolts(mid) * BATT_DIVIDER / 10 < centivolts) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+/********************************************************************************************************************
+postMessage(): post message verbatim, just adding 'M' to the front
+parameters:
+  message: string containing message
+returns: void
+*********************************************************************************************************************/
+void Station::postMessage(const char* mess) {
+  char buf[BUF_LEN];
+  MsgWriter mw(buf, BUF_LEN);  // longer messages are cut short
+  mw.put('M');
+  mw.putStr(mess);
+  publish("ws/messages", mw);
+}
+
+/*******************************************************************************************************************
+postRT(): posts a realtime sample from the Sampler as 'R' CSV and/or a binary frame, or holds it in the batch.
+While the broker cannot be reached, the sample is held for store-and-forward instead. Until the time is known
+the sample goes out stamped in seconds since boot (below TIME_VALID_2K: unsynced) rather than waiting for SNTP.
+parameters: sample: rtFrame holding the sample
+returns: void
+********************************************************************************************************************/
+void Station::postRT(const rtFrame& sample) {
+  rtFrame fr = sample;
+  fr.queueUs = (uint32_t)halMicros() - fr.capUs;
+  _volts = fr.volts;
+  if (fr.time2k < TIME_VALID_2K && _bootShift != 0) fr.time2k += _bootShift;  // taken before the time was set
+  if (_batch.enabled()) {  // hold the sample back until the batch is full or old enough
+    if (_batch.add(fr) || _batch.due(fr.time2k)) flushBatch();
+    return;
+  }
+  if (!_mqtt.connected() || !postLive(fr)) _forward.push(fr);
+}
+
+/*******************************************************************************************************************
+postLive(): posts one realtime sample in the current frame mode, the 'R' message with its trace if tracing is on
+parameters: fr: rtFrame holding the sample
+returns: boolean: true if every post succeeded
+********************************************************************************************************************/
+bool Station::postLive(const rtFrame& fr) {
+  bool ok = true;
+  if (_frameMode != FRAME_MODE_BIN) {
+    MsgWriter mw(_rtBuf, sizeof(_rtBuf));
+    mw.put('R');
+    frameToCSV(csvFrame(fr), mw);  // same fields as RainWind/Sensors getCSVRT() plus the battery reading
+    mqttLoop();
+    if (_trace) traceToCSV(fr, (uint32_t)halMicros() - fr.capUs, mw);
+    ok = publish("ws/csv", mw);
+  }
+  if (_frameMode != FRAME_MODE_CSV) ok = postFrame(fr) && ok;
+  return ok;
+}
+
+/*******************************************************************************************************************
+serviceForward(): replays samples held during an outage, oldest first: at most one batch (BATCH_MAX samples) every
+FWD_INTERVAL_MS, so live samples and Shed requests keep their turn. A batch that cannot be posted stays held.
+Samples held from before the time was known are replayed back-dated if it is known by then, otherwise with their
+unsynced stamps (seconds since boot), as they would have gone out live.
+parameters: none
+returns: void
+********************************************************************************************************************/
+void Station::serviceForward() {
+  if (_forward.count() == 0 || !_mqtt.connected()) return;
+  unsigned long now = halMillis();
+  if (now - _lastForward < FWD_INTERVAL_MS) return;
+  _lastForward = now;
+  rtFrame frs[BATCH_MAX];
+  int n = 0, taken = 0;
+  while (n < BATCH_MAX && taken < _forward.count()) {
+    if (_forward.get(taken++, &frs[n])) n++;  // a frame failing its CRC is skipped
+  }
+  if (n == 0 || postSamples(frs, n)) _forward.discard(taken);
+}
+
+/*******************************************************************************************************************
+startCatchUp(): starts a range catch-up: the records are then posted a few at a time by serviceCatchUp()
+parameters: req: const char*: the request after its 'C' header: "<from>,<to>[,<step>[,<seq>]]"
+returns: void
+********************************************************************************************************************/
+void Station::startCatchUp(const char* req) {
+  unsigned long from, to, step = 1, seq = 0;
+  if (sscanf(req, "%lu,%lu,%lu,%lu", &from, &to, &step, &seq) < 2 || !_catchUp.begin(from, to, step, seq)) {
+    postMessage("Shed request rejected: bad catch-up range");
+  }
+}
+
+/*******************************************************************************************************************
+serviceCatchUp(): posts the next records of a range catch-up, as many as the loop's time budget allows
+Each record: "K<seq>,<hour>" followed by the 'H' message fields; hours not in the log are skipped.
+End of range: "E<next seq>,<records sent>". Nothing is posted while the broker is down, and a record (or the
+end marker) whose post fails is posted again on a later tick: the catch-up resumes where it stopped.
+parameters: tickStart: unsigned long: halMillis() at the start of this loop
+returns: boolean: true if anything was posted
+********************************************************************************************************************/
+bool Station::serviceCatchUp(unsigned long tickStart) {
+  if (!_mqtt.connected()) return false;
+  int posted = 0;
+  uint32_t h, seq;
+  histRec rec;
+  while (_catchUp.active() && posted < CATCHUP_PER_TICK && (halMillis() - tickStart < CATCHUP_BUDGET_MS)) {
+    if (!_catchUp.next(&h, &seq)) {
+      MsgWriter mw(_rtBuf, BUF_LEN);
+      mw.put('E');
+      mw.putUInt(_catchUp.seq());
+      mw.put(',');
+      mw.putUInt(_catchUp.sent());
+      if (!publish("ws/csv", mw)) return posted > 0;
+      _catchUp.stop();
+      return true;
+    }
+    if (!_histLog.find(h, &rec)) {  // RAM index only: no flash access
+      _catchUp.advance();
+      continue;
+    }
+    MsgWriter mw(_rtBuf, BUF_LEN);
+    mw.put('K');
+    mw.putUInt(seq);
+    mw.put(',');
+    mw.putUInt(h);
+    RainWind::makeCSVHr(csvHour(rec.rw), mw);
+    Sensors::makeCSV(rec.s.mean, mw);
+    if (!postCSV(mw)) break;  // link lost: this hour again next time
+    _catchUp.advance();
+    _catchUp.countSent();
+    posted++;
+  }
+  return posted > 0;
+}
+
+/*******************************************************************************************************************
+flushBatch(): posts all samples held in the batch (or, if that fails, holds them for store-and-forward), then empties
+the batch
+parameters: none
+returns: void
+********************************************************************************************************************/
+void Station::flushBatch() {
+  int n = _batch.count();
+  if (n == 0) return;
+  if (!_mqtt.connected() || !postSamples(_batch.samples(), n)) {
+    for (int i = 0; i < n; i++) _forward.push(_batch.sample(i));
+  }
+  _batch.clear();
+}
+
+/*******************************************************************************************************************
+postSamples(): posts several samples as one message per active format (used for batches and replayed samples)
+  binary: the frames back to back on ws/bin (each frame carries its own sequence number and timestamp)
+  CSV: "B<t0>;<dt>,<fields>;<dt>,<fields>..." on ws/csv: t0 is the first sample's time (seconds since 1/1/2000;
+  below TIME_VALID_2K seconds since boot, the time being unknown), dt each sample's offset from t0 in seconds and
+  <fields> as in the 'R' message; with tracing on each entry ends ":<seq>,<capture>" (see captureToCSV())
+parameters:
+  frs: const rtFrame*: the samples, oldest first
+  n: int: number of samples (at most BATCH_MAX)
+returns: boolean: true if every post succeeded
+********************************************************************************************************************/
+bool Station::postSamples(const rtFrame* frs, int n) {
+  bool ok = true;
+  if (_frameMode != FRAME_MODE_CSV) {
+    byte buf[BATCH_MAX * FRAME_LEN];
+    int len = 0;
+    for (int i = 0; i < n; i++) len += encodeFrame(frs[i], buf + len);
+    ok = publish("ws/bin", buf, len);
+  }
+  if (_frameMode != FRAME_MODE_BIN) {
+    uint32_t t0 = frs[0].time2k;
+    MsgWriter mw(_batchBuf, BATCH_BUF_LEN);
+    mw.put('B');
+    mw.putUInt(t0);
+    for (int i = 0; i < n; i++) {
+      mw.put(';');
+      mw.putUInt(frs[i].time2k - t0);
+      frameToCSV(csvFrame(frs[i]), mw);
+      if (_trace) captureToCSV(frs[i], mw);
+    }
+    mqttLoop();
+    ok = publish("ws/csv", mw) && ok;
+  }
+  return ok;
+}
+
+/*******************************************************************************************************************
+setBatch(): sets realtime batching (Shed request "Bnn" or "Bnn,sss") and confirms it to the Shed
+Any samples already held are posted first.
+parameters:
+  maxSamples: int: samples per message (0 or 1: no batching)
+  maxSecs: unsigned long: oldest sample age (seconds) that forces the batch out
+returns: void
+********************************************************************************************************************/
+void Station::setBatch(int maxSamples, unsigned long maxSecs) {
+  char mBuf[BUF_LEN];
+  flushBatch();
+  if (maxSamples > BATCH_MAX) maxSamples = BATCH_MAX;
+  _batch.begin(maxSamples, maxSecs);
+  sprintf(mBuf, "Batch %d samples; %lu secs", maxSamples, maxSecs);
+  postMessage(mBuf);
+}
+
+/*******************************************************************************************************************
+postFrame(): encodes a realtime sample as a binary frame and posts it on ws/bin
+parameters: fr: rtFrame holding the sample
+returns: boolean: true if posted
+********************************************************************************************************************/
+bool Station::postFrame(const rtFrame& fr) {
+  byte buf[FRAME_LEN];
+  int len = encodeFrame(fr, buf);
+  return publish("ws/bin", buf, len);
+}
+
+/*******************************************************************************************************************
+setFrameMode(): selects CSV, binary or both for realtime samples (Shed request "Fn") and confirms it to the Shed
+parameters: mode: int: FRAME_MODE_CSV, FRAME_MODE_BIN or FRAME_MODE_BOTH
+returns: void
+********************************************************************************************************************/
+void Station::setFrameMode(int mode) {
+  char mBuf[BUF_LEN];
+  if (mode < FRAME_MODE_CSV || mode > FRAME_MODE_BOTH) {
+    postMessage("Shed request rejected: unknown frame mode");
+    return;
+  }
+  _frameMode = mode;
+  sprintf(mBuf, "Frame mode %d; version %d", _frameMode, FRAME_VERSION);
+  postMessage(mBuf);
+}
+
+/*******************************************************************************************************************
+setTrace(): turns the realtime trace on or off (Shed request "Tn") and confirms it to the Shed. With it on, each 'R'
+message ends with ";<seq>,<capture>,<tip>,<gust>,<queue>,<publish>" (see traceToCSV()), for host/LatTrace.cpp.
+Batched and replayed samples in 'B' messages carry their sequence number and capture time only.
+parameters: on: bool
+returns: void
+********************************************************************************************************************/
+void Station::setTrace(bool on) {
+  _trace = on;
+  postMessage(on ? "Trace on" : "Trace off");
+}
+
+/*******************************************************************************************************************
+setCsvVersion(): sets the units of the CSV fields (Shed request "Vn", see CSV_VERSION) and confirms it to the Shed.
+Like the frame mode, it goes back to the default at a reboot.
+parameters: version: int: 1 or 2
+returns: void
+********************************************************************************************************************/
+void Station::setCsvVersion(int version) {
+  char mBuf[BUF_LEN];
+  if (version < 1 || version > CSV_VERSION_MAX) {
+    postMessage("Shed request rejected: unknown CSV version");
+    return;
+  }
+  _csvVersion = version;
+  sprintf(mBuf, "CSV version %d", _csvVersion);
+  postMessage(mBuf);
+}
+
+/************************************************************************************************************
+shedRequested(): handles a Shed request. Settings requests ("Fn": frame mode, "Bnn": batching, "Tn": trace,
+"Vn": CSV version), range catch-up
+requests ("C...") and day blocks ("D...") are taken care of here; for hourly
+data requests returns a struct hdc object. No hourly request iff hd.day == 0
+parameters: none
+returns: hdc structure (hour, day, header character): day ==0 signifies no request
+*************************************************************************************************************/
+hdc Station::shedRequested() {
+  hdc hd1;
+  hd1.day = 0;
+  hd1.hour = 0;
+  if(!_bNewMessage) {
+    return hd1;
+  }
+  // Message received by here
+  for (unsigned int i = 0; i < _icLength; i++) _qticBuf[i] = (char)_bqticBuf[i];
+  _qticBuf[_icLength] = '\0'; // zero terminated!
+
+  hd1.hdr = _qticBuf[0]; // at least one character: Header
+  switch (hd1.hdr) {
+    case 'H':
+      // Shed must send message in format "DddHdd":
+      if (_icLength != HRREQ_LEN) {
+        postMessage("Shed request rejected: wrong length");
+        break;
+      }
+      if (!isdigit((unsigned char)_qticBuf[1]) || !isdigit((unsigned char)_qticBuf[2]) ||
+        !isdigit((unsigned char)_qticBuf[4]) || !isdigit((unsigned char)_qticBuf[5])) {
+        postMessage("Shed request rejected: bad day or hour");
+        break;
+      }
+      {
+        int day = 10 * (_qticBuf[1] - '0') + _qticBuf[2] - '0';
+        int hour = 10 * (_qticBuf[4] - '0') + _qticBuf[5] - '0';
+        if (day < 1 || day > 31 || hour > 23) {  // day 0 means no request; the hour indexes _recentHours
+          postMessage("Shed request rejected: bad day or hour");
+          break;
+        }
+        hd1.day = day;
+        hd1.hour = hour;
+      }
+      break;
+    case 'F':
+      // frame mode: "F0" CSV, "F1" binary, "F2" both
+      if (_icLength != 2) {
+        postMessage("Shed request rejected: wrong length");
+        break;
+      }
+      setFrameMode(_qticBuf[1] - '0');
+      break;
+    case 'T':
+      // realtime trace: "T0" off, "T1" on
+      if (_icLength != 2 || (_qticBuf[1] != '0' && _qticBuf[1] != '1')) {
+        postMessage("Shed request rejected: bad trace setting");
+        break;
+      }
+      setTrace(_qticBuf[1] == '1');
+      break;
+    case 'V':
+      // CSV version: "V1" raw vane and battery readings, "V2" degrees and centivolts
+      if (_icLength != 2) {
+        postMessage("Shed request rejected: wrong length");
+        break;
+      }
+      setCsvVersion(_qticBuf[1] - '0');
+      break;
+    case 'C':
+      // range catch-up: "C<from>,<to>[,<step>[,<seq>]]" (hours since 1/1/2000)
+      startCatchUp(_qticBuf + 1);
+      break;
+    case 'D': {
+      // day block: "D<day>" (days since 1/1/2000)
+      unsigned long day;
+      if (sscanf(_qticBuf + 1, "%lu", &day) != 1) {
+        postMessage("Shed request rejected: bad day");
+        break;
+      }
+      postDay(day);
+      break;
+    }
+    case 'B': {
+      // batching: "Bnn" (samples per message) or "Bnn,sss" (and oldest sample age in seconds)
+      int n = 0;
+      unsigned long secs = BATCH_SECS;
+      if (sscanf(_qticBuf + 1, "%d,%lu", &n, &secs) < 1) {
+        postMessage("Shed request rejected: bad batch size");
+        break;
+      }
+      setBatch(n, secs);
+      break;
+    }
+    default: // no valid character
+      postMessage("Shed request header not recognised");
+      break;
+  }
+
+  flushICBuffer(); // empty buffer, because relevant info is now stored in struct hd
+  _bNewMessage = false;
+  return hd1;
+}
+
+// UNDER REVIEW BELOW
+void Station::flushICBuffer() {
+}
@@ -0,0 +1,118 @@
+#ifndef STATION_H
+#define STATION_H
+
+#include "Hal.h"
+#include "Config.h"
+#include "RainWind.h"
+#include "Sensors.h"
+#include "Chrono.h"
+#include "Timebase.h"
+#include "Telemetry.h"
+#include "Batch.h"
+#include "HistLog.h"
+#include "CatchUp.h"
+#include "Sampler.h"
+#include "MqttLink.h"
+#include "LatHist.h"
+#include "Forward.h"
+#include "DayCodec.h"
+
+// struct hdc acts as a kind of "primary key" unique identifier for each "package" of weather data (realtime, hourly or daily)
+struct hdc {
+  int day;
+  int hour;
+  char hdr;
+};
+
+// ----------------------------------------------------------------------------------------------------------
+//-------------------------------------- Version of 17/10/2026 ----------------------------------------------
+
+// Class Station: the board-independent body of the sketch. It owns the Sampler (RainWind, Sensors, Chrono and
+// their scheduled jobs) and is itself the network side: it drains the Sampler's queues, builds and posts the
+// MQTT messages and handles the Shed requests. On the ESP32 the two sides run as separate FreeRTOS tasks on
+// separate cores (startTasks()); the host build runs both, one after the other, in tick().
+// RoofBB.ino keeps WiFi and MQTT.
+
+class Station {
+
+  public:
+  Station();
+  void begin(unsigned long unix2k);
+  bool startTasks();
+  byte tick();
+  void waitForNextTick();
+  byte netTick();
+  void onShedMessage(const byte* message, unsigned int length);
+  void setFrameMode(int mode);
+  void setBatch(int maxSamples, unsigned long maxSecs);
+  void setTrace(bool on);
+  void setCsvVersion(int version);
+  void postMessage(const char* mess);
+  void setBootMessage(const char* mess) { _bootMessage = mess; }
+  const clockStats& timeStats() { return _timebase.stats(); }
+  Sampler& sampler() { return _sampler; }  // the sampling side on its own: host benchmark only
+
+  private:
+  static void sampleTask(void* arg);
+  static void netTask(void* arg);
+  void drainQueues();
+  void postLinkStats();
+  void postStats(const statPeriod& sp);
+  void serviceClock();
+  bool publish(const char* topic, const char* payload);
+  bool publish(const char* topic, const byte* payload, unsigned int length);
+  bool publish(const char* topic, MsgWriter& mw) { return publish(topic, mw.bytes(), mw.length()); }
+  void mqttLoop();
+  bool postCSV(MsgWriter& mw);
+  rtFrame csvFrame(const rtFrame& fr);
+  wrHr csvHour(const wrHr& rw);
+  static int rawVolts(int centivolts);
+  void postRT(const rtFrame& fr);
+  bool postLive(const rtFrame& fr);
+  bool postSamples(const rtFrame* frs, int n);
+  void serviceForward();
+  void serviceDays();
+  bool postFrame(const rtFrame& fr);
+  void flushBatch();
+  void storeHour(const histRec& rec);
+  void postHour(const hdc& hd);
+  bool postDay(uint32_t day2k);
+  bool postDayStats(const dayRec& d);
+  void startCatchUp(const char* req);
+  bool serviceCatchUp(unsigned long tickStart);
+  hdc shedRequested();
+  void flushICBuffer();
+
+  Timebase _timebase;  // the one time source of both sides: disciplined here, by SNTP
+  Sampler _sampler;
+  Chrono _chrono;  // network side's dates (hour stamps of Shed requests)
+  Batch _batch;
+  HistLog _histLog;
+  CatchUp _catchUp;
+  MqttLink _mqtt;
+  Forward _forward;
+  unsigned long _lastForward;
+  uint32_t _blocksHeld[DAY_HELD_LEN];  // days whose ws/day block failed at midnight, oldest first
+  int _numBlocksHeld;
+  dayRec _statsHeld[DAY_HELD_LEN];  // days whose 'D' message failed, oldest first
+  int _numStatsHeld;
+  unsigned long _bootShift;  // seconds from "since boot" to the time, once known (0 until then)
+  const char* _bootMessage;  // posted once MQTT first comes up
+  LatHist _pubHist, _mqttHist, _netHist;  // network side latencies: publish, client loop, whole netTick()
+  histRec _recentHours[HPD];  // last day's hours, for 'H' requests the log cannot answer
+  int _volts;  // battery reading from the latest frame, appended to the CSV messages
+  unsigned int _framesDropped;
+  int _frameMode;
+  int _csvVersion;  // units of the CSV fields (see CSV_VERSION)
+  bool _trace;  // 'R' messages carry their trace
+  bool _bNewMessage;
+  unsigned int _icLength;
+  byte _bqticBuf[QT_LEN];
+  char _qticBuf[QT_LEN];
+  char _rtBuf[BUF_LEN + TRACE_CSV_LEN];
+  char _batchBuf[BATCH_BUF_LEN];
+  dayRecs _day;  // postDay()'s hours (about 3 KB): too large for the network task's stack (TASK_STACK)
+  byte _dayBuf[DAY_BLOCK_MAX];
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "Telemetry.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Telemetry: encoder and decoder for the binary realtime frame (layout in Telemetry.h)
+
+static byte* put16(byte* p, uint16_t v) {
+  p[0] = (byte)(v & 0xff);
+  p[1] = (byte)(v >> 8);
+  return p + 2;
+}
+
+static byte* put32(byte* p, uint32_t v) {
+  return put16(put16(p, (uint16_t)(v & 0xffff)), (uint16_t)(v >> 16));
+}
+
+static byte* put24(byte* p, uint32_t v) {
+  *put16(p, (uint16_t)(v & 0xffff)) = (byte)(v >> 16);
+  return p + 3;
+}
+
+static uint16_t get16(const byte* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const byte* p) {
+  return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint32_t get24(const byte* p) {
+  return (uint32_t)get16(p) | ((uint32_t)p[2] << 16);
+}
+
+// Compile-time CRC table: the CRC-16/CCITT-FALSE remainder of each byte value, so crc16() takes one lookup per byte
+struct crcTable {
+  uint16_t v[256];
+};
+
+constexpr crcTable makeCrcTable() {
+  crcTable t = {};
+  for (int i = 0; i < 256; i++) {
+    uint16_t crc = (uint16_t)(i << 8);
+    for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    t.v[i] = crc;
+  }
+  return t;
+}
+
+static constexpr crcTable _crc = makeCrcTable();
+static_assert(_crc.v[1] == 0x1021 && _crc.v[255] == 0x1ef0, "CRC-16/CCITT-FALSE table");
+
+/*********************************************************************************************************
+crc16(): CRC-16/CCITT-FALSE (poly 0x1021, init 0xffff) of a byte buffer
+parameters:
+  buf: bytes to check
+  len: number of bytes
+returns: uint16_t: the CRC
+**********************************************************************************************************/
+uint16_t crc16(const byte* buf, unsigned int len) {
+  uint16_t crc = 0xffff;
+  for (unsigned int i = 0; i < len; i++) {
+    crc = (uint16_t)((crc << 8) ^ _crc.v[(crc >> 8) ^ buf[i]]);
+  }
+  return crc;
+}
+
+/*********************************************************************************************************
+encodeFrame(): packs a realtime sample into a binary frame
+parameters:
+  fr: rtFrame holding the sample, its sequence number, timestamp and capture time
+  buf: byte buffer of at least FRAME_LEN bytes
+returns: int: frame length (FRAME_LEN)
+**********************************************************************************************************/
+int encodeFrame(const rtFrame& fr, byte* buf) {
+  byte* p = buf;
+  *p++ = FRAME_MAGIC | FRAME_VERSION;
+  p = put16(p, fr.seq);
+  p = put32(p, fr.time2k);
+  p = put24(p, fr.capFrac);
+  p = put16(p, fr.buckets);
+  p = put16(p, fr.revs3);
+  p = put16(p, fr.maxRevs);
+  p = put16(p, fr.wd);
+  for (int i = 0; i < SENS_FIELDS; i++) {
+    if (SENS_BYTES[i] == 2) p = put16(p, (uint16_t)fr.sens[i]);
+    else *p++ = (byte)fr.sens[i];
+  }
+  p = put16(p, fr.volts);
+  p = put16(p, fr.revs2Min);
+  p = put16(p, fr.revs10Min);
+  put16(p, crc16(buf, FRAME_LEN - 2));
+  return FRAME_LEN;
+}
+
+/*********************************************************************************************************
+frameToCSV(): appends a sample's fields as CSV in the order of the 'R' message (without its header): at most
+RT_CSV_LEN characters, in the sample's units (Station converts them for CSV version 1)
+parameters:
+  fr: rtFrame holding the sample
+  mw: MsgWriter&: the message being built
+returns: void
+**********************************************************************************************************/
+void frameToCSV(const rtFrame& fr, MsgWriter& mw) {
+  const long rw[] = { fr.buckets, fr.revs3, fr.maxRevs, fr.wd };
+  const long v[] = { fr.volts };
+  mw.putCSV(CSV_RW_RT, rw);
+  mw.putCSV(CSV_SENS, fr.sens);
+  mw.putCSV(CSV_BATT, v);
+}
+
+// putCapture(): "<seq>,<seconds since 1/1/2000>.<microseconds>"
+static void putCapture(const rtFrame& fr, MsgWriter& mw) {
+  mw.putUInt(fr.seq);
+  mw.put(',');
+  mw.putUInt(fr.time2k);
+  mw.put('.');
+  mw.putInt(fr.capFrac, 6, 6);
+}
+
+/*********************************************************************************************************
+traceToCSV(): appends a sample's trace to its 'R' message: ";<seq>,<capture>,<tip>,<gust>,<queue>,<publish>"
+(at most TRACE_CSV_LEN characters). capture is the time taken (seconds since 1/1/2000, to the microsecond);
+the rest are microseconds: tip and gust from the event (-1: none) to capture, queue and publish from capture to
+the network task taking the sample and to the message being handed to the MQTT client
+parameters:
+  fr: rtFrame holding the sample
+  publishUs: uint32_t: capture to publish (microseconds)
+  mw: MsgWriter&: the message being built
+returns: void
+**********************************************************************************************************/
+void traceToCSV(const rtFrame& fr, uint32_t publishUs, MsgWriter& mw) {
+  const int32_t v[] = { fr.tipAge, fr.gustAge, (int32_t)fr.queueUs, (int32_t)publishUs };
+  mw.put(';');
+  putCapture(fr, mw);
+  mw.putCSV(CSV_TRACE, v);
+}
+
+/*********************************************************************************************************
+captureToCSV(): appends a sample's sequence number and capture time to its entry in a 'B' message, with
+tracing on: ":<seq>,<capture>" (at most CAPTURE_CSV_LEN characters), capture as in traceToCSV(). A batched or
+replayed sample can then be matched to the sequence of the live ones (host/LatTrace.cpp).
+parameters:
+  fr: rtFrame holding the sample
+  mw: MsgWriter&: the message being built
+returns: void
+**********************************************************************************************************/
+void captureToCSV(const rtFrame& fr, MsgWriter& mw) {
+  mw.put(':');
+  putCapture(fr, mw);
+}
+
+/*********************************************************************************************************
+decodeFrame(): unpacks and checks a binary frame
+parameters:
+  buf: received bytes
+  len: number of bytes received
+  fr: rtFrame to receive the sample
+returns: boolean: true if the frame has the right header, version, length and CRC (the trace, but for the
+capture time, is cleared)
+**********************************************************************************************************/
+bool decodeFrame(const byte* buf, unsigned int len, rtFrame* fr) {
+  if (len != FRAME_LEN || buf[0] != (FRAME_MAGIC | FRAME_VERSION)) return false;
+  if (get16(buf + FRAME_LEN - 2) != crc16(buf, FRAME_LEN - 2)) return false;
+  const byte* p = buf + 1;
+  fr->seq = get16(p); p += 2;
+  fr->time2k = get32(p); p += 4;
+  fr->capFrac = get24(p); p += 3;
+  fr->buckets = get16(p); p += 2;
+  fr->revs3 = get16(p); p += 2;
+  fr->maxRevs = get16(p); p += 2;
+  fr->wd = get16(p); p += 2;
+  for (int i = 0; i < SENS_FIELDS; i++) {
+    if (SENS_BYTES[i] == 2) {
+      uint16_t v = get16(p); p += 2;
+      fr->sens[i] = CSV_SENS[i].sign ? (int16_t)v : v;
+    }
+    else {
+      byte v = *p++;
+      fr->sens[i] = CSV_SENS[i].sign ? (int8_t)v : v;
+    }
+  }
+  fr->volts = get16(p); p += 2;
+  fr->revs2Min = get16(p); p += 2;
+  fr->revs10Min = get16(p);
+  fr->capUs = 0;
+  fr->tipAge = -1;
+  fr->gustAge = -1;
+  fr->queueUs = 0;
+  return true;
+}
@@ -0,0 +1,70 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "Hal.h"
+#include "MsgWriter.h"
+#include "Sensors.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Telemetry: compact binary realtime frame, the alternative to the 'R' CSV string on ws/csv.
+// Frames go out on ws/bin once the Shed has opted in (see Station::setFrameMode()).
+// Layout (little-endian, FRAME_LEN bytes):
+//   0     header: FRAME_MAGIC | FRAME_VERSION
+//   1-2   sequence number (wraps)
+//   3-6   timestamp: seconds since 1/1/2000; below TIME_VALID_2K seconds since boot (unsynced: posted before
+//         SNTP first set the time)
+//   7-9   capture: microseconds past the timestamp (0-999999)
+//   10-11 buckets     12-13 revs3     14-15 maxRevs   16-17 wind direction (degrees)
+//   18-   the sensors' fields in StationSensors order, 1 or 2 bytes each as their drivers declare (SENS_FRAME_LEN
+//         bytes): with the standard sensors 18-19 temperature (signed), 20 humidity, 21-22 pressure (hPa),
+//         23 lightA, 24 lightB
+//   then  battery (centivolts), revs in last 2 minutes, revs in last 10 minutes: 2 bytes each
+//   last 2 CRC-16/CCITT of everything before it
+// A different sensor set is a different layout: FRAME_VERSION identifies the layout of the standard set.
+// Sequence number and capture time identify a sample wherever it goes (live, batched, replayed after an outage);
+// the rest of its trace (event and stage times) is not in the frame: with tracing on (see Station::setTrace())
+// it is appended to the 'R' message by traceToCSV(), and each 'B' entry gets its sequence number and capture time
+// from captureToCSV().
+// Telemetry.cpp has no board dependencies, so host tools decode with the same code.
+
+#define FRAME_MAGIC 0xB0
+#define FRAME_VERSION 4
+#define FRAME_LEN (26 + SENS_FRAME_LEN)
+
+#define FRAME_MODE_CSV 0   // 'R' CSV on ws/csv only (default, for old consumers)
+#define FRAME_MODE_BIN 1   // binary frames on ws/bin only
+#define FRAME_MODE_BOTH 2  // both
+
+constexpr csvField CSV_TRACE[] = {  // tip, gust, queue, publish (microseconds)
+  { 1, 10, true }, { 1, 10, true }, { 1, 10, true }, { 1, 10, true } };
+constexpr int CAPTURE_CSV_LEN = 1 + 5 + 1 + ULONG_LEN + 1 + 6;  // ":<seq>,<capture>" (or ';' first)
+constexpr int TRACE_CSV_LEN = CAPTURE_CSV_LEN + csvLen(CSV_TRACE);  // ";<seq>,<capture>" and the rest
+
+// Structure holding one realtime sample as carried by a frame
+struct rtFrame {
+  uint16_t seq;
+  uint32_t time2k;
+  uint16_t buckets;
+  uint16_t revs3;
+  uint16_t maxRevs;
+  uint16_t wd;
+  int32_t sens[SENS_FIELDS];  // in StationSensors order
+  uint16_t volts;
+  uint16_t revs2Min;
+  uint16_t revs10Min;
+  // trace (not in the frame, but for capFrac)
+  uint32_t capUs;  // capture: halMicros() when the sample was taken (both tasks' counter)
+  uint32_t capFrac;  // capture time's microseconds past time2k (in the frame)
+  int32_t tipAge;  // microseconds from the latest rain tip to capture (-1: no tip since the previous sample)
+  int32_t gustAge;  // microseconds from maxRevs being reached to capture (-1: no gust)
+  uint32_t queueUs;  // capture to the network task taking the sample
+};
+
+int encodeFrame(const rtFrame& fr, byte* buf);
+void frameToCSV(const rtFrame& fr, MsgWriter& mw);
+void traceToCSV(const rtFrame& fr, uint32_t publishUs, MsgWriter& mw);
+void captureToCSV(const rtFrame& fr, MsgWriter& mw);
+bool decodeFrame(const byte* buf, unsigned int len, rtFrame* fr);
+uint16_t crc16(const byte* buf, unsigned int len);
+
+#endif
@@ -0,0 +1,143 @@
+#include "Timebase.h"
+
+// ------------------------------ Version of 17/10/2026 ---------------------------------
+// Timebase class: the model and its discipline by SNTP samples (see Timebase.h)
+
+#define TB_SLEW_RATE (((int64_t)CLOCK_SLEW_PPM << TB_RATE_SHIFT) / 1000000LL)
+#define TB_DRIFT_MAX (((int64_t)CLOCK_DRIFT_MAX_PPM << TB_RATE_SHIFT) / 1000000LL)
+
+// Part of a slew applied e microseconds after the base
+static int64_t slewDone(int64_t slewUs, uint64_t e) {
+  int64_t done = ((int64_t)e * TB_SLEW_RATE) >> TB_RATE_SHIFT;
+  if (slewUs >= 0) return done < slewUs ? done : slewUs;
+  return done < -slewUs ? -done : slewUs;
+}
+
+Timebase::Timebase() : _seq(0) {};
+
+/*********************************************************************************************************
+begin(): starts the clock at a time from the internet, with no drift correction and nothing to slew
+parameters: unix2k: unsigned long: seconds since 1/1/2000 (0 if unknown: the first SNTP sample sets it)
+returns: void
+**********************************************************************************************************/
+void Timebase::begin(unsigned long unix2k) {
+  model m;
+  m.baseMono = halMicros64();
+  m.baseUs = (uint64_t)unix2k * 1000000ULL;
+  m.rate = 0;
+  m.slewUs = 0;
+  write(m);
+  _lastSyncMono = m.baseMono;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+/*********************************************************************************************************
+toUs(): the time at a halMicros64() reading
+parameters: mono: uint64_t: halMicros64() value (not before the last rebase: earlier values read as the base)
+returns: uint64_t: microseconds since 1/1/2000
+**********************************************************************************************************/
+uint64_t Timebase::toUs(uint64_t mono) {
+  model m;
+  read(&m);
+  return apply(m, mono);
+}
+
+uint64_t Timebase::apply(const model& m, uint64_t mono) {
+  uint64_t e = mono > m.baseMono ? mono - m.baseMono : 0ULL;  // a reading taken just before a rebase
+  return m.baseUs + e + (uint64_t)((((int64_t)e * m.rate) >> TB_RATE_SHIFT) + slewDone(m.slewUs, e));
+}
+
+/*********************************************************************************************************
+read(), write(): the sequence lock. One writer (the network task); readers on other tasks retry while a write
+is under way, so a reader must never preempt the writer on the same core (the tasks are on separate cores)
+**********************************************************************************************************/
+void Timebase::read(model* m) {
+  for (;;) {
+    uint32_t seq = _seq.load(std::memory_order_acquire);
+    if (seq & 1) continue;
+    *m = _m;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_seq.load(std::memory_order_relaxed) == seq) return;
+  }
+}
+
+void Timebase::write(const model& m) {
+  uint32_t seq = _seq.load(std::memory_order_relaxed);
+  _seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _m = m;
+  _seq.store(seq + 2, std::memory_order_release);
+}
+
+/*********************************************************************************************************
+rebase(): moves the model's base to a later reading without changing the time it gives: the slew already
+applied is taken off what is left to slew
+parameters:
+  m: model* to rebase
+  mono: uint64_t: halMicros64() value of the new base
+returns: void
+**********************************************************************************************************/
+void Timebase::rebase(model* m, uint64_t mono) {
+  uint64_t e = mono > m->baseMono ? mono - m->baseMono : 0ULL;
+  m->baseUs = apply(*m, mono);
+  m->slewUs -= slewDone(m->slewUs, e);
+  m->baseMono = mono;
+}
+
+/*********************************************************************************************************
+discipline(): takes one SNTP sample. The offset is stepped on the first sample or if beyond CLOCK_STEP_MS,
+otherwise slewed away from now on. The part of the offset not explained by the slew still pending since the
+last sample is put down to the crystal: it corrects the drift estimate (by half, for noise), so later offsets
+shrink towards the SNTP jitter.
+parameters:
+  mono: uint64_t: halMicros64() when the SNTP time was received
+  refUs: uint64_t: the SNTP time then, microseconds since 1/1/2000
+returns: boolean: true if the clock was stepped
+**********************************************************************************************************/
+bool Timebase::discipline(uint64_t mono, uint64_t refUs) {
+  model m = _m;  // only this task writes the model
+  uint64_t now = halMicros64();
+  if (mono > now) mono = now;
+  if (mono < m.baseMono) mono = m.baseMono;
+  int64_t offset = (int64_t)(refUs - apply(m, mono));
+  bool step = _stats.syncs == 0 || offset > 1000LL * CLOCK_STEP_MS || offset < -1000LL * CLOCK_STEP_MS;
+  _stats.syncs++;
+  _stats.offsetUs = offset > TB_OFFSET_MAX ? TB_OFFSET_MAX : offset < -TB_OFFSET_MAX ? -TB_OFFSET_MAX : (long)offset;
+  if (step) {
+    _stats.steps++;
+    m.baseMono = mono;
+    m.baseUs = refUs;
+    m.slewUs = 0;
+    rebase(&m, now);
+  }
+  else {
+    uint64_t dt = mono - _lastSyncMono;
+    int64_t pending = m.slewUs - slewDone(m.slewUs, mono - m.baseMono);  // slew still to come at mono
+    int64_t toCome = slewDone(m.slewUs, now - m.baseMono) - slewDone(m.slewUs, mono - m.baseMono);
+    rebase(&m, now);  // continuous at now: readers never see the time go back
+    if (dt >= 1000000ULL * CLOCK_DRIFT_MIN_SECS) {
+      int64_t rate = m.rate + ((offset - pending) * ((int64_t)1 << TB_RATE_SHIFT) / (int64_t)dt) / 2;
+      m.rate = rate > TB_DRIFT_MAX ? TB_DRIFT_MAX : rate < -TB_DRIFT_MAX ? -TB_DRIFT_MAX : rate;
+    }
+    m.slewUs = offset - toCome;
+  }
+  _lastSyncMono = mono;
+  _stats.driftPpb = TB_PPB(m.rate);
+  _stats.slewUs = (long)m.slewUs;
+  write(m);
+  return step;
+}
+
+/*********************************************************************************************************
+service(): rebases the model every CLOCK_REBASE_SECS, so that the time since the base (and its products with
+the rates) stays in range however long the SNTP server is out of reach. Called by the network task.
+parameters: none
+returns: void
+**********************************************************************************************************/
+void Timebase::service() {
+  uint64_t now = halMicros64();
+  if (now - _m.baseMono < 1000000ULL * CLOCK_REBASE_SECS) return;
+  model m = _m;
+  rebase(&m, now);
+  write(m);
+}
@@ -0,0 +1,65 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "Hal.h"
+#include "Config.h"
+#include <atomic>
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Timebase: the station's one source of time: microseconds since 1/1/2000, 64-bit (no wrap), derived from the
+// monotonic halMicros64() counter (esp_timer on the ESP32) by a linear model:
+//   time = baseUs + e + e * rate + slew(e)      e = halMicros64() - baseMono
+// rate corrects the crystal's measured drift; slew(e) removes an offset found by SNTP at CLOCK_SLEW_PPM, capped
+// at the offset, so time never jumps and never runs backwards. Only an offset beyond CLOCK_STEP_MS (or the first
+// sync) steps the clock. Rates are in units of 2^-32 (about 0.23 ppb): applying them is a multiply and a shift.
+// The model is written by the network task (discipline(), service()) and read by both tasks through a sequence
+// lock: a reader retries if the model changed while it was being copied. Chrono (dates, hour boundaries) and
+// every sample timestamp read the time from here.
+
+#define TB_RATE_SHIFT 32
+#define TB_OFFSET_MAX 2000000000L  // reported offsets saturate here (32-bit long): a first step can be decades
+#define TB_PPB(rate) ((long)(((int64_t)(rate) * 1000000000LL) >> TB_RATE_SHIFT))  // rate as parts per billion
+
+// Structure holding the discipline's results
+struct clockStats {
+  unsigned long syncs;  // SNTP samples used
+  unsigned long steps;  // of them, offsets stepped rather than slewed
+  long offsetUs;  // last measured offset: SNTP time minus our time
+  long driftPpb;  // measured crystal drift correction
+  long slewUs;  // offset being slewed away at the last sync
+};
+
+class Timebase {
+
+  public:
+  Timebase();
+  void begin(unsigned long unix2k);
+  uint64_t nowUs() { return toUs(halMicros64()); }
+  uint64_t toUs(uint64_t mono);
+  unsigned long now() { return (unsigned long)(nowUs() / 1000000ULL); }
+  uint32_t generation() { return _seq.load(std::memory_order_acquire); }
+  bool discipline(uint64_t mono, uint64_t refUs);
+  void service();
+  bool synced() { return _stats.syncs > 0; }
+  const clockStats& stats() { return _stats; }
+
+  private:
+  // The model: copied whole by readers
+  struct model {
+    uint64_t baseMono;  // halMicros64() at the base
+    uint64_t baseUs;  // time at the base
+    int64_t rate;  // drift correction (2^-32 units)
+    int64_t slewUs;  // offset to slew away (signed)
+  };
+  static uint64_t apply(const model& m, uint64_t mono);
+  void read(model* m);
+  void write(const model& m);
+  void rebase(model* m, uint64_t mono);
+
+  model _m;
+  std::atomic<uint32_t> _seq;  // odd while the model is being written
+  uint64_t _lastSyncMono;  // halMicros64() of the last SNTP sample
+  clockStats _stats;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "WindDir.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// WindDir class: vector-mean wind direction (see WindDir.h)
+
+int16_t WindDir::_sin[WD_STEPS + WD_STEPS / 4];
+
+WindDir::WindDir() {};
+
+/*********************************************************************************************************
+begin(): fills the sine table (once) and clears all accumulators
+parameters: none
+returns: void
+**********************************************************************************************************/
+void WindDir::begin() {
+  for (int i = 0; i < WD_STEPS + WD_STEPS / 4; i++) {
+    _sin[i] = (int16_t)lround(WD_ONE * sin(2 * M_PI * (i + 0.5) / WD_STEPS));  // step centre
+  }
+  _subS = _subC = 0;
+  _subN = 0;
+  takeRT();
+  takeHour();
+}
+
+/*********************************************************************************************************
+weigh(): closes the readings since the last call into one mean unit vector and adds it to the realtime and
+hourly sums, weighted by the revs counted over the same time
+parameters: revs: int: anemometer pulses drained since the last call
+returns: void
+**********************************************************************************************************/
+void WindDir::weigh(int revs) {
+  if (_subN == 0) return;  // no readings: the revs carry no direction
+  int32_t s = _subS / (int32_t)_subN, c = _subC / (int32_t)_subN;
+  _rtUS += s;
+  _rtUC += c;
+  _rtS += (int64_t)s * revs;
+  _rtC += (int64_t)c * revs;
+  _rtRevs += revs;
+  _hrS += (int64_t)s * revs;
+  _hrC += (int64_t)c * revs;
+  _hrRevs += revs;
+  _subS = _subC = 0;
+  _subN = 0;
+}
+
+/*********************************************************************************************************
+takeRT(): direction over the realtime interval just ended, and starts the next. A calm interval still has a
+direction (where the vane rests): the unweighted mean.
+parameters: none
+returns: int: degrees (0-359), NUL_WD if there were no readings
+**********************************************************************************************************/
+int WindDir::takeRT() {
+  int wd = _rtRevs ? angle(_rtS, _rtC) : angle(_rtUS, _rtUC);
+  _rtS = _rtC = _rtUS = _rtUC = 0;
+  _rtRevs = 0;
+  return wd;
+}
+
+/*********************************************************************************************************
+takeHour(): revs-weighted direction over the hour just ended, and starts the next
+parameters: none
+returns: int: degrees (0-359), NUL_WD if the hour was calm
+**********************************************************************************************************/
+int WindDir::takeHour() {
+  int wd = _hrRevs ? angle(_hrS, _hrC) : NUL_WD;
+  _hrS = _hrC = 0;
+  _hrRevs = 0;
+  return wd;
+}
+
+/*********************************************************************************************************
+angle(): compass direction of a summed vector
+parameters: s, c: int64_t: east and north components
+returns: int: degrees (0-359), NUL_WD for a null vector (readings that cancel out)
+**********************************************************************************************************/
+int WindDir::angle(int64_t s, int64_t c) {
+  if (s == 0 && c == 0) return NUL_WD;
+  int wd = (int)lround(atan2((double)s, (double)c) * 180 / M_PI);
+  return wd < 0 ? wd + 360 : wd % 360;
+}
@@ -0,0 +1,47 @@
+#ifndef WINDDIR_H
+#define WINDDIR_H
+
+#include "Hal.h"
+#include "Config.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// WindDir: wind direction as a vector mean, from the vane readings of the continuous ADC.
+// A direction cannot be averaged as a number (359 and 1 degrees would average to south), so each reading is
+// turned into a unit vector (sin, cos from a WD_STEPS table, fixed point) and the vectors are summed.
+// Whenever the anemometer pulses are drained (about every second) the readings since the previous drain become
+// one mean vector, weighted by the revs counted over the same time: light airs, when the vane wanders, count for
+// little. The realtime and hourly directions are the angles of the weighted sums. Directions are compass degrees
+// (0-359, clockwise from north); NUL_WD when there is nothing to average.
+
+#define WD_STEPS 256  // vane resolution kept: 1.4 degrees
+#define WD_ONE 16384  // unit vector length in the table
+
+class WindDir {
+
+  public:
+  WindDir();
+  void begin();
+  void add(int raw, int n = 1) {  // n vane readings averaging raw (0-4095)
+    int step = (((raw - WD_NORTH_RAW) & 4095) * WD_STEPS) >> 12;
+    _subS += n * _sin[step];
+    _subC += n * _sin[step + WD_STEPS / 4];
+    _subN += n;
+  }
+  void weigh(int revs);
+  int takeRT();
+  int takeHour();
+
+  private:
+  static int angle(int64_t s, int64_t c);
+
+  static int16_t _sin[WD_STEPS + WD_STEPS / 4];  // sine table, extended by a quarter turn for the cosine
+  int32_t _subS, _subC;  // readings since the last weigh()
+  uint32_t _subN;
+  int64_t _rtS, _rtC;  // realtime interval: revs-weighted
+  int64_t _rtUS, _rtUC;  // and unweighted, for a calm interval
+  uint32_t _rtRevs;
+  int64_t _hrS, _hrC;  // hour: revs-weighted
+  uint32_t _hrRevs;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "WindStats.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// WindStats class: prefix sums over a ring of per-bin pulse counts (see WindStats.h)
+
+WindStats::WindStats() {};
+
+/*********************************************************************************************************
+begin(): clears all windows and hourly accumulators
+parameters: nowUs: uint32_t: time (microseconds) at which the first bin starts
+returns: void
+**********************************************************************************************************/
+void WindStats::begin(uint32_t nowUs) {
+  for (int i = 0; i < WS_RING_LEN; i++) _prefix[i] = 0;
+  _ix = 0;
+  _binStart = nowUs;
+  _binCount = 0;
+  _rtGust = 0;
+  _rtGustUs = nowUs;
+  windHour wh;
+  takeHour(&wh);
+}
+
+/*********************************************************************************************************
+addPulse(): counts one anemometer pulse (pulses must be added in time order)
+parameters: t: uint32_t: pulse timestamp (microseconds)
+returns: void
+**********************************************************************************************************/
+void WindStats::addPulse(uint32_t t) {
+  advanceTo(t);
+  _binCount++;
+  _hrRevs++;
+}
+
+/*********************************************************************************************************
+addPulses(): counts a number of anemometer pulses at once (from a counter polled at t; in time order)
+parameters:
+  t: uint32_t: poll time (microseconds)
+  n: int: pulses since the previous poll
+returns: void
+**********************************************************************************************************/
+void WindStats::addPulses(uint32_t t, int n) {
+  advanceTo(t);
+  _binCount += n;
+  _hrRevs += n;
+}
+
+/*********************************************************************************************************
+advanceTo(): closes every bin that ended at or before t. After a long gap only one ring's worth of empty
+bins is written: the rest are added straight to the hourly accumulators.
+parameters: t: uint32_t: time now (microseconds)
+returns: void
+**********************************************************************************************************/
+void WindStats::advanceTo(uint32_t t) {
+  uint32_t bins = (t - _binStart) / WS_BIN_US;
+  if (bins > WS_RING_LEN) {
+    uint32_t skip = bins - WS_RING_LEN;  // empty bins that will be overwritten anyway
+    closeBin();  // the open bin may hold pulses
+    skip--;
+    _hrBins += skip;
+    _hrHist[0] += skip;
+    _binStart += (skip + 1) * WS_BIN_US;
+    bins = WS_RING_LEN;
+  }
+  while (bins-- > 0) {
+    closeBin();
+    _binStart += WS_BIN_US;
+  }
+}
+
+/*********************************************************************************************************
+closeBin(): appends the open bin's count to the ring and updates the gust and hourly statistics
+parameters: none
+returns: void
+**********************************************************************************************************/
+void WindStats::closeBin() {
+  uint16_t prev = _prefix[_ix];
+  _ix = (_ix + 1 == WS_RING_LEN) ? 0 : _ix + 1;
+  _prefix[_ix] = prev + _binCount;
+  _binCount = 0;
+
+  int g = gust3s();
+  if (g > _rtGust) {
+    _rtGust = g;
+    _rtGustUs = _binStart + WS_BIN_US;
+  }
+  if (g > _hrGust) _hrGust = g;
+  _hrBins++;
+  _hrSum += g;
+  _hrSumSq += (uint64_t)(g * g);
+  int band = g / WS_HIST_WIDTH;
+  _hrHist[band < WS_HIST_BINS ? band : WS_HIST_BINS - 1]++;
+}
+
+/*********************************************************************************************************
+window(): pulses counted in the last closed bins
+parameters: bins: int: window length in bins (< WS_RING_LEN)
+returns: int: pulse count
+**********************************************************************************************************/
+int WindStats::window(int bins) {
+  int from = _ix - bins;
+  if (from < 0) from += WS_RING_LEN;
+  return (uint16_t)(_prefix[_ix] - _prefix[from]);
+}
+
+/*********************************************************************************************************
+takeRtGust(): highest 3 s count since the previous call (i.e. over the last realtime interval)
+parameters: atUs: uint32_t*: receives the time (microseconds) the gust was first reached: the end of its bin
+returns: int: gust in revs per 3 seconds
+**********************************************************************************************************/
+int WindStats::takeRtGust(uint32_t* atUs) {
+  int g = _rtGust;
+  *atUs = _rtGustUs;
+  _rtGust = gust3s();
+  _rtGustUs = _binStart;  // end of the last closed bin
+  return g;
+}
+
+/*********************************************************************************************************
+takeHour(): hands over the hourly statistics and starts a new hour
+parameters: wh: windHour* to receive the statistics
+returns: void
+**********************************************************************************************************/
+void WindStats::takeHour(windHour* wh) {
+  wh->revs = _hrRevs;
+  wh->gust = _hrGust;
+  wh->mean10 = 0;
+  wh->sd10 = 0;
+  if (_hrBins > 0) {
+    float mean = (float)_hrSum / _hrBins;
+    float var = (float)_hrSumSq / _hrBins - mean * mean;
+    wh->mean10 = (int)(10.0f * mean + 0.5f);
+    wh->sd10 = (var > 0.0f) ? (int)(10.0f * sqrtf(var) + 0.5f) : 0;
+  }
+  for (int i = 0; i < WS_HIST_BINS; i++) {
+    wh->hist[i] = _hrHist[i];
+    _hrHist[i] = 0;
+  }
+  _hrBins = 0;
+  _hrRevs = 0;
+  _hrGust = 0;
+  _hrSum = 0;
+  _hrSumSq = 0;
+}
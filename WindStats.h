@@ -0,0 +1,57 @@
+#ifndef WINDSTATS_H
+#define WINDSTATS_H
+
+#include "Hal.h"
+#include "Config.h"
+
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// WindStats: sliding-window anemometer statistics with a fixed memory footprint.
+// Pulses are counted into WS_BIN_US bins; a ring of running (prefix) sums of those counts gives the pulses in
+// any window of up to WS_RING_LEN - 1 bins with one subtraction, so every statistic costs O(1) per bin:
+//   3 second gust (WMO: 3 s running count sampled every 0.25 s), 2 and 10 minute counts,
+//   and hourly max / mean / standard deviation and histogram of the 3 s counts.
+// All speeds are in anemometer revs per 3 seconds, the unit of the realtime revs3 field.
+
+// Structure used to hand over one hour's wind statistics
+struct windHour {
+  int revs;  // pulses in the hour
+  int gust;  // highest 3 s count
+  int mean10;  // mean 3 s count x 10
+  int sd10;  // standard deviation of the 3 s count x 10
+  uint16_t hist[WS_HIST_BINS];  // quarter seconds spent in each 3 s count band (WS_HIST_WIDTH wide)
+};
+
+class WindStats {
+
+  public:
+  WindStats();
+  void begin(uint32_t nowUs);
+  void addPulse(uint32_t t);
+  void addPulses(uint32_t t, int n);
+  void advanceTo(uint32_t t);
+  int gust3s() { return window(WS_GUST_BINS); }
+  int revs2Min() { return window(WS_2MIN_BINS); }
+  int revs10Min() { return window(WS_10MIN_BINS); }
+  int takeRtGust(uint32_t* atUs);
+  void takeHour(windHour* wh);
+
+  private:
+  void closeBin();
+  int window(int bins);
+
+  uint16_t _prefix[WS_RING_LEN];  // running pulse count at the end of each bin (wraps harmlessly)
+  int _ix;  // ring index of the last closed bin
+  uint32_t _binStart;
+  uint16_t _binCount;
+  int _rtGust;
+  uint32_t _rtGustUs;  // when it was reached: end of its bin
+  // hourly accumulators
+  uint32_t _hrBins;
+  uint32_t _hrRevs;
+  int _hrGust;
+  uint32_t _hrSum;
+  uint64_t _hrSumSq;
+  uint16_t _hrHist[WS_HIST_BINS];
+};
+
+#endif
@@ -0,0 +1,73 @@
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// BmpCheck: the BMP085 driver against the datasheet, not against itself.
+// 1. The compensation (BmpSensor::b5(), BmpSensor::pressure()) on the datasheet's worked example: calibration
+//    AC1-MD as printed, UT = 27898, UP = 23843 at oss 0 must give T = 150 (0.1 C) and p = 69964 Pa.
+// 2. The host device model (HalLinux.cpp) holds that calibration and, at the set pressure of the example, returns
+//    its raw values.
+// 3. The whole driver (BmpSensor::step() at BMP_OSS, through the I2C model, SensConv and CONV_CAL) over the
+//    pressure range: the hPa reported must be the set pressure truncated, within the 0 to 5 Pa the datasheet's
+//    integer algorithm reads low of the exact formulas the model inverts.
+//   bmpcheck        exit status 1 on failure (ctest)
+// Build: see CMakeLists.txt
+
+#include "HalLinux.h"
+#include "Sensors.h"
+#include <stdio.h>
+
+static const bmpCal DATASHEET = { 408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868 };
+static int _failures = 0;
+
+static void check(bool ok, const char* what, long got, long expected) {
+  printf("%s: %s: %ld (expected %ld)\n", ok ? "ok  " : "FAIL", what, got, expected);
+  if (!ok) _failures++;
+}
+
+// convert(): starts a conversion on the model and reads the result register, as the datasheet sequences it
+static long convert(byte ctrl, unsigned int len) {
+  byte cmd[] = { 0xF4, ctrl };
+  byte d[3];
+  halI2CWrite(BMP_ADDR, cmd, sizeof(cmd));
+  halAdvanceMicros(30000);
+  halI2CWriteRead(BMP_ADDR, 0xF6, d, len);
+  return len == 2 ? (d[0] << 8) | d[1] : (((long)d[0] << 16) | ((long)d[1] << 8) | d[2]);
+}
+
+int main() {
+  long b5 = BmpSensor::b5(DATASHEET, 27898);  // 2400: the example prints X2 = -2344 rounded, C division gives -2343
+  check((b5 + 8) / 16 == 150, "datasheet T (0.1 C)", (b5 + 8) / 16, 150);
+  long p = BmpSensor::pressure(DATASHEET, b5, 23843, 0);
+  check(p == 69964, "datasheet p (Pa)", p, 69964);
+
+  halSetBMP(69964.0f);
+  byte c[22];
+  halI2CWriteRead(BMP_ADDR, 0xAA, c, sizeof(c));
+  long ac1 = (int16_t)((c[0] << 8) | c[1]), md = (int16_t)((c[20] << 8) | c[21]);
+  check(ac1 == DATASHEET.ac1 && md == DATASHEET.md, "model calibration AC1, MD", ac1 * 10000 + md,
+    DATASHEET.ac1 * 10000L + DATASHEET.md);
+  long ut = convert(0x2E, 2);
+  check(ut == 27898, "model UT", ut, 27898);
+  long up = convert(0x34, 3) >> 8;
+  check(up >= 23842 && up <= 23843, "model UP at 69964 Pa, oss 0", up, 23843);
+
+  BmpSensor bmp;
+  check(bmp.begin(), "driver finds the model", 1, 1);
+  long worst = 0, wrong = 0, count = 0;
+  for (long pa = 30000; pa <= 110000; pa += 7) {
+    halSetBMP((float)pa);
+    int out = 0;
+    for (int phase = 0; phase < BmpSensor::PHASES; phase++) {
+      bmp.step(phase, &out);
+      halAdvanceMicros(30000);
+    }
+    long low = (pa - 5) / 100, high = pa / 100;  // truncated, allowing the integer algorithm's 0 to 5 Pa
+    if (out < low || out > high) {
+      if (wrong++ == 0) printf("first wrong: %ld Pa -> %d hPa\n", pa, out);
+    }
+    if (pa / 100 - out > worst) worst = pa / 100 - out;
+    count++;
+  }
+  check(wrong == 0, "driver hPa over 300-1100 hPa, readings wrong", wrong, 0);
+  printf("%ld pressures: the truncated hPa differs by at most %ld\n", count, worst);
+  printf("BMP085 check: %s\n", _failures ? "FAILED" : "passed");
+  return _failures ? 1 : 0;
+}
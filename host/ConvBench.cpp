@@ -0,0 +1,108 @@
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// ConvBench: checks the fixed point sensor conversions (SensConv) against the floating point code they replace,
+// over every raw reading (every Pa for the pressure), and times one conversion of each kind.
+// Accuracy: largest difference of the fixed point value (before calibration) from the exact value, and the
+// raw readings whose reported integer differs from the one the old code reported, with the first few of them.
+// The old code is reproduced expression for expression, floats included: the Adafruit drivers' conversions
+// (AHT: raw * 200 / 0x100000 - 50 and raw * 100 / 0x100000; BMP085: the integer Pa as a float; BH1750:
+// raw / 1.2) followed by Sensors.cpp's (int)(t + 0.5f), (int)(h + 0.5f), (int)(0.01f * p) and
+// (int)(13.0 * log(1.0f + lux)). (int)(t + 0.5f) truncates towards zero, so below -0.5 C it does not round.
+// Run with the default CONV_CAL (no gains; the offsets that truncate).
+// Build: g++ -O2 -I.. -o convbench ConvBench.cpp ../SensConv.cpp
+
+#include "Config.h"
+#include "SensConv.h"
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#define BENCH_LOOPS 20000000L
+
+#define SHOW_MISMATCHES 4  // examples printed per conversion
+
+struct accuracy {
+  double maxErr;  // units
+  long mismatches;  // reported integer differs from the old code's
+  long count;
+  long examples[SHOW_MISMATCHES][3];  // raw reading, reported, old
+};
+
+// The old code's integers, as Sensors.cpp and the Adafruit drivers computed them
+static int oldTemperature(uint32_t raw) { return (int)((((float)raw * 200 / 0x100000) - 50) + 0.5f); }
+static int oldHumidity(uint32_t raw) { return (int)((((float)raw * 100) / 0x100000) + 0.5f); }
+static int oldPressure(long pa) { return (int)(0.01f * (float)pa); }
+static int oldLight(uint16_t raw) { return (int)(13.0 * log(1.0f + raw / 1.2f)); }
+
+static void check(accuracy* a, long raw, int32_t fixed, int reported, double exact, int old) {
+  double err = fabs(fixed / (double)(1 << CONV_FRAC_BITS) - exact);
+  if (err > a->maxErr) a->maxErr = err;
+  if (reported != old) {
+    if (a->mismatches < SHOW_MISMATCHES) {
+      a->examples[a->mismatches][0] = raw;
+      a->examples[a->mismatches][1] = reported;
+      a->examples[a->mismatches][2] = old;
+    }
+    a->mismatches++;
+  }
+  a->count++;
+}
+
+static void report(const char* name, const accuracy& a) {
+  printf("%-12s %8ld readings: max error %.5f, differ from the old code %ld\n", name, a.count, a.maxErr,
+    a.mismatches);
+  for (long i = 0; i < a.mismatches && i < SHOW_MISMATCHES; i++) {
+    printf("    raw %ld: %ld (old %ld)\n", a.examples[i][0], a.examples[i][1], a.examples[i][2]);
+  }
+}
+
+/*********************************************************************************************************
+timeIt(): times BENCH_LOOPS calls of a conversion on varying readings
+parameters:
+  name: label
+  fn: conversion, called with readings i * step & mask
+returns: void
+**********************************************************************************************************/
+template <typename F> static void timeIt(const char* name, F fn) {
+  volatile double sink = 0;
+  double acc = 0;
+  clock_t t0 = clock();
+  for (long i = 0; i < BENCH_LOOPS; i++) acc += fn((uint32_t)(i * 40503L));
+  sink = acc;
+  double ns = (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / BENCH_LOOPS;
+  printf("%-24s %6.2f ns per conversion\n", name, ns);
+  (void)sink;
+}
+
+int main() {
+  static accuracy t, tNeg, h, p, l;
+  for (uint32_t raw = 0; raw < (1UL << 20); raw++) {
+    int32_t v = convAhtTemperature(raw);
+    double exact = raw / 1048576.0 * 200 - 50;
+    check(exact < -0.5 ? &tNeg : &t, raw, v, convOutput(CONV_TEMPERATURE, v), exact, oldTemperature(raw));
+    v = convAhtHumidity(raw);
+    check(&h, raw, v, convOutput(CONV_HUMIDITY, v), raw / 1048576.0 * 100, oldHumidity(raw));
+  }
+  for (long pa = 30000; pa <= 110000; pa++) {
+    int32_t v = convPressure(pa);
+    check(&p, pa, v, convOutput(CONV_PRESSURE, v), pa / 100.0, oldPressure(pa));
+  }
+  for (uint32_t raw = 0; raw < 65536; raw++) {
+    int32_t v = convLight((uint16_t)raw);
+    check(&l, raw, v, convOutput(CONV_LIGHTA, v), 13.0 * log(1.0 + raw / 1.2), oldLight((uint16_t)raw));
+  }
+  report("temperature", t);
+  report("  below -0.5", tNeg);
+  report("humidity", h);
+  report("pressure", p);
+  report("light", l);
+
+  timeIt("temperature fixed", [](uint32_t r) { return (double)convOutput(CONV_TEMPERATURE, convAhtTemperature(r & 0xfffff)); });
+  timeIt("temperature float", [](uint32_t r) { return (double)oldTemperature(r & 0xfffff); });
+  timeIt("humidity fixed", [](uint32_t r) { return (double)convOutput(CONV_HUMIDITY, convAhtHumidity(r & 0xfffff)); });
+  timeIt("humidity float", [](uint32_t r) { return (double)oldHumidity(r & 0xfffff); });
+  timeIt("pressure fixed", [](uint32_t r) { return (double)convOutput(CONV_PRESSURE, convPressure(90000 + (r & 0x3fff))); });
+  timeIt("pressure float", [](uint32_t r) { return (double)oldPressure(90000 + (r & 0x3fff)); });
+  timeIt("light fixed", [](uint32_t r) { return (double)convOutput(CONV_LIGHTA, convLight((uint16_t)r)); });
+  timeIt("light float (double log)", [](uint32_t r) { return (double)oldLight((uint16_t)r); });
+  return 0;
+}
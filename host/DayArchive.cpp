@@ -0,0 +1,189 @@
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// DayArchive: host-side encoder/decoder for the compressed day blocks posted by the Roof on ws/day.
+//   dayarchive             reads one block per line as hex (mosquitto_sub -t ws/day -F %x) and writes each hour
+//                          as CSV: ISO date and hour, rain and wind (buckets, revs, gust, mean, sd, direction,
+//                          the speed histogram bands), then the sensors' means (as in the 'H' message), minima
+//                          and maxima, and the battery's mean, minimum and maximum
+//   dayarchive bench dir   encodes every day held in a history log directory (a copy of the Roof's LittleFS, or
+//                          a host run's halFsRoot()), checks the round trip, and reports the block sizes against
+//                          the raw records and the same hours as CSV, and the encode/decode throughput
+// Build: g++ -I.. -o dayarchive DayArchive.cpp ../DayCodec.cpp ../HistLog.cpp ../Telemetry.cpp
+
+#include "Config.h"
+#include "DayCodec.h"
+#include "HistLog.h"
+#include "Telemetry.h"
+#include "Chrono.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#define BENCH_REPEATS 200  // encode/decode passes over the whole log, for timing
+
+/*********************************************************************************************************
+hexToBytes(): converts a line of hex digits to bytes
+parameters:
+  line: zero-terminated text
+  buf: receives the bytes
+  maxLen: size of buf
+returns: int: number of bytes, or -1 if the line is not valid hex
+**********************************************************************************************************/
+static int hexToBytes(const char* line, byte* buf, int maxLen) {
+  int n = 0;
+  while (isxdigit((unsigned char)line[0]) && isxdigit((unsigned char)line[1])) {
+    if (n == maxLen) return -1;
+    unsigned int v;
+    sscanf(line, "%2x", &v);
+    buf[n++] = (byte)v;
+    line += 2;
+  }
+  return (*line == '\0' || *line == '\n' || *line == '\r') ? n : -1;
+}
+
+/*********************************************************************************************************
+csvHour(): one hour's fields as CSV, in dayColumn order
+parameters:
+  r: histRec
+  buf: receives the CSV (4 * BUF_LEN)
+returns: int: CSV length
+**********************************************************************************************************/
+static int csvHour(const histRec& r, char* buf) {
+  int len = sprintf(buf, "%04d,%04d,%04d,%04d,%04d,%04d", r.rw.bucketsHr, r.rw.revsHr, r.rw.gustHr, r.rw.meanHr, r.rw.sdHr,
+    r.rw.wdHr);
+  for (int i = 0; i < WS_HIST_BINS; i++) len += sprintf(buf + len, ",%d", r.rw.histHr[i]);
+  for (int i = 0; i < SENS_FIELDS; i++) len += sprintf(buf + len, ",%04d", r.s.mean.v[i]);
+  for (int i = 0; i < SENS_FIELDS; i++) len += sprintf(buf + len, ",%04d", r.s.lo.v[i]);
+  for (int i = 0; i < SENS_FIELDS; i++) len += sprintf(buf + len, ",%04d", r.s.hi.v[i]);
+  len += sprintf(buf + len, ",%d,%d,%d", r.batt.mean, r.batt.lo, r.batt.hi);
+  return len;
+}
+
+/*********************************************************************************************************
+printDay(): writes the hours of a decoded day as CSV lines
+parameters: d: decoded dayRecs
+returns: void
+**********************************************************************************************************/
+static void printDay(const dayRecs& d) {
+  char buf[BUF_LEN * 4];
+  long days = d.day2k;
+  for (int h = 0; h < HPD; h++) {
+    if ((d.present & (1UL << h)) == 0) continue;
+    csvHour(d.hours[h], buf);
+    printf("%d-%02d-%02dT%02d,%s\n", Chrono::civilYear(days), Chrono::civilMonth(days), Chrono::civilDate(days), h, buf);
+  }
+}
+
+static int decode() {
+  char line[2 * DAY_BLOCK_MAX + 4];
+  byte buf[DAY_BLOCK_MAX];
+  dayRecs d;
+  long bad = 0;
+  while (fgets(line, sizeof(line), stdin)) {
+    int len = hexToBytes(line, buf, sizeof(buf));
+    if (len < 0 || !decodeDay(buf, len, &d)) {
+      bad++;
+      continue;
+    }
+    printDay(d);
+  }
+  if (bad) fprintf(stderr, "%ld invalid blocks\n", bad);
+  return 0;
+}
+
+/*********************************************************************************************************
+loadDays(): collects the days held in a history log, oldest first
+parameters:
+  log: HistLog opened on the directory
+  days: receives the days (room for HIST_INDEX_LEN / HPD + 2)
+returns: int: number of days with at least one hour
+**********************************************************************************************************/
+static int loadDays(HistLog& log, dayRecs* days) {
+  // The log holds at most HIST_INDEX_LEN consecutive hours: search back from now for the newest one
+  uint32_t newest = (uint32_t)((time(NULL) - SECS_1970_TO_2000) / SECS_PER_HOUR);
+  histRec rec;
+  uint32_t h;
+  for (h = newest; h > 0 && !log.find(h, &rec); h--);
+  if (h == 0) return 0;
+  uint32_t first = h > HIST_INDEX_LEN ? h - HIST_INDEX_LEN : 0;
+  int n = 0;
+  for (uint32_t day = first / HPD; day <= h / HPD; day++) {
+    dayRecs* d = &days[n];
+    memset(d, 0, sizeof(dayRecs));
+    d->day2k = day;
+    for (int i = 0; i < HPD; i++) {
+      if (log.find(day * HPD + i, &d->hours[i])) d->present |= 1UL << i;
+    }
+    if (d->present) n++;
+  }
+  return n;
+}
+
+static int bench(const char* dir) {
+  static HistLog log;
+  static dayRecs days[HIST_INDEX_LEN / HPD + 2];
+  static byte blocks[HIST_INDEX_LEN / HPD + 2][DAY_BLOCK_MAX];
+  int lens[HIST_INDEX_LEN / HPD + 2];
+  if (!log.begin(dir)) {
+    fprintf(stderr, "cannot open %s\n", dir);
+    return 1;
+  }
+  int n = loadDays(log, days);
+  if (n == 0) {
+    fprintf(stderr, "no records in %s\n", dir);
+    return 1;
+  }
+
+  // Round trip and sizes
+  long hours = 0, blockBytes = 0, csvBytes = 0, worst = 0;
+  char buf[BUF_LEN * 4];
+  dayRecs back;
+  for (int i = 0; i < n; i++) {
+    lens[i] = encodeDay(days[i], blocks[i], DAY_BLOCK_MAX);
+    if (lens[i] == 0 || !decodeDay(blocks[i], lens[i], &back) || back.present != days[i].present) {
+      fprintf(stderr, "day %lu: round trip failed\n", (unsigned long)days[i].day2k);
+      return 1;
+    }
+    for (int h = 0; h < HPD; h++) {
+      if ((days[i].present & (1UL << h)) == 0) continue;
+      if (memcmp(&back.hours[h], &days[i].hours[h], sizeof(histRec)) != 0) {
+        fprintf(stderr, "day %lu hour %d: round trip differs\n", (unsigned long)days[i].day2k, h);
+        return 1;
+      }
+      hours++;
+      csvBytes += csvHour(days[i].hours[h], buf) + 1;  // plus line end
+    }
+    blockBytes += lens[i];
+    if (lens[i] > worst) worst = lens[i];
+  }
+  long rawBytes = hours * (long)sizeof(histRec);
+  printf("%d days, %ld hours\n", n, hours);
+  printf("blocks: %ld bytes (%.1f per day, largest %ld)\n", blockBytes, (double)blockBytes / n, worst);
+  printf("raw records: %ld bytes, ratio %.1f\n", rawBytes, (double)rawBytes / blockBytes);
+  printf("CSV: %ld bytes, ratio %.1f\n", csvBytes, (double)csvBytes / blockBytes);
+
+  // Throughput
+  clock_t t0 = clock();
+  for (int r = 0; r < BENCH_REPEATS; r++) {
+    for (int i = 0; i < n; i++) lens[i] = encodeDay(days[i], blocks[i], DAY_BLOCK_MAX);
+  }
+  double encSecs = (double)(clock() - t0) / CLOCKS_PER_SEC;
+  t0 = clock();
+  for (int r = 0; r < BENCH_REPEATS; r++) {
+    for (int i = 0; i < n; i++) decodeDay(blocks[i], lens[i], &back);
+  }
+  double decSecs = (double)(clock() - t0) / CLOCKS_PER_SEC;
+  double mb = (double)rawBytes * BENCH_REPEATS / 1e6;
+  printf("encode: %.1f MB/s of records (%.2f us per day)\n", mb / encSecs, encSecs * 1e6 / ((double)n * BENCH_REPEATS));
+  printf("decode: %.1f MB/s of records (%.2f us per day)\n", mb / decSecs, decSecs * 1e6 / ((double)n * BENCH_REPEATS));
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc == 3 && strcmp(argv[1], "bench") == 0) return bench(argv[2]);
+  if (argc != 1) {
+    fprintf(stderr, "usage: dayarchive < hex blocks | dayarchive bench <history log directory>\n");
+    return 2;
+  }
+  return decode();
+}
@@ -0,0 +1,75 @@
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// FrameDecode: host-side decoder for the binary realtime frames posted by the Roof on ws/bin.
+// Reads one message per line as hex (as printed by: mosquitto_sub -t ws/bin -F %x): a single frame or a batch
+// of frames back to back. Writes the samples
+// as CSV in the same field order as the 'R' message, preceded by sequence number and ISO capture time (to the
+// microsecond).
+// Build: g++ -I.. -o framedecode FrameDecode.cpp ../Telemetry.cpp
+
+#include "Config.h"
+#include "Telemetry.h"
+#include "Chrono.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+/*********************************************************************************************************
+hexToBytes(): converts a line of hex digits to bytes
+parameters:
+  line: zero-terminated text
+  buf: receives the bytes
+  maxLen: size of buf
+returns: int: number of bytes, or -1 if the line is not valid hex
+**********************************************************************************************************/
+static int hexToBytes(const char* line, byte* buf, int maxLen) {
+  int n = 0;
+  while (isxdigit((unsigned char)line[0]) && isxdigit((unsigned char)line[1])) {
+    if (n == maxLen) return -1;
+    unsigned int v;
+    sscanf(line, "%2x", &v);
+    buf[n++] = (byte)v;
+    line += 2;
+  }
+  return (*line == '\0' || *line == '\n' || *line == '\r') ? n : -1;
+}
+
+/*********************************************************************************************************
+printSample(): writes one decoded sample as a CSV line: sequence, ISO capture time, the 'R' message fields, then the
+2 and 10 minute revs
+parameters: fr: decoded rtFrame
+returns: void
+**********************************************************************************************************/
+static void printSample(const rtFrame& fr) {
+  long days = fr.time2k / SECS_PER_DAY;
+  unsigned long secs = fr.time2k % SECS_PER_DAY;
+  char csv[RT_CSV_LEN + 1];
+  MsgWriter mw(csv, sizeof(csv));
+  frameToCSV(fr, mw);
+  printf("%u,%d-%02d-%02dT%02lu:%02lu:%02lu.%06lu%s,%d,%d\n", fr.seq,
+    Chrono::civilYear(days), Chrono::civilMonth(days), Chrono::civilDate(days),
+    secs / SECS_PER_HOUR, (secs % SECS_PER_HOUR) / SECS_PER_MINUTE, secs % SECS_PER_MINUTE,
+    (unsigned long)fr.capFrac, mw.text(), fr.revs2Min, fr.revs10Min);
+}
+
+int main() {
+  char line[2 * BATCH_MAX * FRAME_LEN + 4];
+  byte buf[BATCH_MAX * FRAME_LEN];
+  rtFrame fr;
+  long bad = 0;
+  while (fgets(line, sizeof(line), stdin)) {
+    int len = hexToBytes(line, buf, sizeof(buf));
+    if (len < 0 || len % FRAME_LEN != 0) {
+      bad++;
+      continue;
+    }
+    for (int i = 0; i < len; i += FRAME_LEN) {
+      if (!decodeFrame(buf + i, FRAME_LEN, &fr)) {
+        bad++;
+        continue;
+      }
+      printSample(fr);
+    }
+  }
+  if (bad) fprintf(stderr, "%ld invalid frames\n", bad);
+  return 0;
+}
@@ -0,0 +1,200 @@
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// HistBench: HistLog on the Linux file backend (a directory standing in for LittleFS).
+// Throughput: appends (two passes round the log, so segments are erased and reused) and lookups of random
+// hours still in it, in nanoseconds per call on this machine.
+// Power-loss recovery test: a slot whose commit marker never made it to flash, a slot cut short, an hour logged
+// twice, and an hour logged again after the log has wrapped (its newest record in a lower numbered segment than
+// the older one). Each time the log is reopened, as after a reboot, and must find exactly the committed records,
+// the newest of each hour, count each hour once, and reuse the torn slot.
+//   histbench [-t] [-c <csv file> [-l <label>]]
+// -t runs the test only (exit status 1 on failure: ctest); -c appends "<label>,<name>,<calls>,<ns per call>" lines
+// as LoopBench does.
+// Build: see CMakeLists.txt
+
+#include "HalLinux.h"
+#include "HistLog.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HB_ROOT "histbench_fs"
+#define HB_HOUR0 (8991UL * 24)  // 13/08/2024 00:00
+#define HB_FINDS 100000L
+
+static int _failures = 0;
+
+static double nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) _failures++;
+}
+
+// segPath(): a segment file's name, as HistLog builds it
+static void segPath(int seg, char* buf) {
+  snprintf(buf, HIST_PATH_LEN + 16, "%s/hist%d.log", HB_ROOT, seg);
+}
+
+// fresh(): an empty log directory
+static const char* fresh() {
+  char path[HIST_PATH_LEN + 16];
+  for (int seg = 0; seg < HIST_SEGMENTS; seg++) {
+    segPath(seg, path);
+    remove(path);
+  }
+  return halFsRoot();
+}
+
+static long fileSize(int seg) {
+  char path[HIST_PATH_LEN + 16];
+  segPath(seg, path);
+  struct stat st;
+  return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+// record(): a record for an hour, tagged to tell its copies apart
+static histRec record(uint32_t hour2k, int tag) {
+  histRec rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.hour2k = hour2k;
+  rec.batt.mean = tag;
+  return rec;
+}
+
+// holds(): the log finds the hour, with this tag
+static bool holds(HistLog& log, uint32_t hour2k, int tag) {
+  histRec rec;
+  return log.find(hour2k, &rec) && rec.batt.mean == tag;
+}
+
+/*********************************************************************************************************
+testTorn(): power cut while a record was being written: its slot complete but for the commit marker (flushed
+last), or cut short. Neither may be found after the reboot, the records before them must, and the next append
+must go into the torn slot.
+parameters: cut: bool: true to cut the slot short, false to leave its commit marker out
+returns: void
+**********************************************************************************************************/
+static void testTorn(bool cut) {
+  static HistLog log;
+  log.begin(fresh());
+  for (int i = 0; i < 11; i++) log.append(record(HB_HOUR0 + i, i));
+  long slotLen = fileSize(0) / 11;
+  char path[HIST_PATH_LEN + 16];
+  segPath(0, path);
+  if (cut) truncate(path, 10 * slotLen + slotLen / 2);
+  else {
+    FILE* f = fopen(path, "r+b");
+    fseek(f, 11 * slotLen - 2, SEEK_SET);
+    fputc(0xff, f);
+    fputc(0xff, f);
+    fclose(f);
+  }
+
+  log.begin(halFsRoot());  // the reboot
+  bool found = true;
+  for (int i = 0; i < 10; i++) found = holds(log, HB_HOUR0 + i, i) && found;
+  check(found, cut ? "cut short: committed records found" : "no commit marker: committed records found");
+  check(!holds(log, HB_HOUR0 + 10, 10), cut ? "cut short: torn record ignored" : "no commit marker: torn record ignored");
+  check(log.records() == 10, "torn: 10 records counted");
+  log.append(record(HB_HOUR0 + 10, 100));
+  check(fileSize(0) == 11 * slotLen, "torn: slot reused");
+  log.begin(halFsRoot());
+  check(holds(log, HB_HOUR0 + 10, 100) && log.records() == 11, "torn: rewritten record found after reboot");
+}
+
+/*********************************************************************************************************
+testDuplicate(): an hour logged twice is found at its newest record and counted once, before and after a reboot
+parameters: none
+returns: void
+**********************************************************************************************************/
+static void testDuplicate() {
+  static HistLog log;
+  log.begin(fresh());
+  log.append(record(HB_HOUR0, 1));
+  log.append(record(HB_HOUR0 + 1, 2));
+  log.append(record(HB_HOUR0, 3));
+  check(holds(log, HB_HOUR0, 3) && log.records() == 2, "duplicate hour: newest found, counted once");
+  log.begin(halFsRoot());
+  check(holds(log, HB_HOUR0, 3) && log.records() == 2, "duplicate hour: same after reboot");
+}
+
+/*********************************************************************************************************
+testWrapped(): the log filled, then an hour held in the last segment logged again: the copy goes to the first
+segment (erased and reused), which begin() scans first. The newer copy must win on its sequence number.
+parameters: none
+returns: void
+**********************************************************************************************************/
+static void testWrapped() {
+  static HistLog log;
+  log.begin(fresh());
+  int n = HIST_SEGMENTS * HIST_SEG_RECORDS;
+  for (int i = 0; i < n; i++) log.append(record(HB_HOUR0 + i, i));
+  uint32_t last = HB_HOUR0 + n - 1;
+  log.append(record(last, -1));
+  unsigned long hours = (unsigned long)(n - HIST_SEG_RECORDS);  // the first segment's hours erased
+  check(holds(log, last, -1) && log.records() == hours, "wrapped: newest copy found, hours counted once");
+  log.begin(halFsRoot());
+  check(holds(log, last, -1), "wrapped: newest copy found after reboot, though in a lower segment");
+  check(log.records() == hours, "wrapped: hours counted once after reboot");
+  check(!holds(log, HB_HOUR0, 0) && holds(log, HB_HOUR0 + HIST_SEG_RECORDS, HIST_SEG_RECORDS),
+    "wrapped: erased segment gone, the next one kept");
+}
+
+int main(int argc, char** argv) {
+  bool testOnly = false;
+  const char* csvPath = NULL;
+  const char* label = "local";
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0) testOnly = true;
+    else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) csvPath = argv[++i];
+    else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) label = argv[++i];
+    else {
+      fprintf(stderr, "usage: histbench [-t] [-c <csv file> [-l <label>]]\n");
+      return 2;
+    }
+  }
+  halSetFsRoot(HB_ROOT);
+
+  testTorn(false);
+  testTorn(true);
+  testDuplicate();
+  testWrapped();
+  printf("Recovery test: %s\n", _failures ? "FAILED" : "passed");
+  if (testOnly || _failures) return _failures ? 1 : 0;
+
+  static HistLog log;
+  log.begin(fresh());
+  long appends = 2L * HIST_SEGMENTS * HIST_SEG_RECORDS;
+  double t0 = nowNs();
+  for (long i = 0; i < appends; i++) log.append(record(HB_HOUR0 + i, (int)i));
+  double appendNs = (nowNs() - t0) / appends;
+  long oldest = appends - (long)log.records();
+  long hits = 0;
+  srand(1);
+  t0 = nowNs();
+  for (long i = 0; i < HB_FINDS; i++) {
+    histRec rec;
+    if (log.find(HB_HOUR0 + oldest + rand() % log.records(), &rec)) hits++;
+  }
+  double findNs = (nowNs() - t0) / HB_FINDS;
+  printf("%-32s %8s %12s\n", "measurement", "calls", "ns/call");
+  printf("%-32s %8ld %12.0f\n", "HistLog::append", appends, appendNs);
+  printf("%-32s %8ld %12.0f\n", "HistLog::find", HB_FINDS, findNs);
+  if (hits != HB_FINDS) printf("find: %ld of %ld hours missing\n", HB_FINDS - hits, HB_FINDS);
+  if (csvPath) {
+    FILE* csv = fopen(csvPath, "a");
+    if (csv) {
+      fprintf(csv, "%s,HistLog::append,%ld,%.0f\n", label, appends, appendNs);
+      fprintf(csv, "%s,HistLog::find,%ld,%.0f\n", label, HB_FINDS, findNs);
+      fclose(csv);
+    }
+  }
+  return hits == HB_FINDS ? 0 : 1;
+}
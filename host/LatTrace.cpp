@@ -0,0 +1,263 @@
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// LatTrace: host-side latency and loss report on the realtime trace (Shed request "T1": see Station::setTrace()).
+// Reads publications on ws/csv and ws/messages, one per line, as "<unix time> <topic> <payload>", the time being
+// when the line was received (decimals to the microsecond or beyond):
+//   a station, through a local broker:
+//     mosquitto_pub -h localhost -t ws/shedRequests -m T1
+//     mosquitto_sub -h localhost -t ws/csv -t ws/messages -F '%U %t %p' -W 3600 | lattrace
+//   the simulator (with "0 shed T1" in the trace), delivering each publication 2 ms after it is made:
+//     simulator -u 2 < trace | lattrace
+// At the end of the input (and every -r <secs> of it) writes:
+//   per-stage latency distributions (count, p50, p90, p99, max): rain tip and gust to capture, capture to the
+//   network task (queue), to publish, publish to delivery (across the station's and this host's clocks: SNTP on
+//   both, or the simulator), capture to delivery and event to delivery; and capture to delivery of the samples
+//   batched or replayed in 'B' messages
+//   the traced samples' sequence, 'R' and 'B' alike: lost (gaps never filled), late (reordered 'R'), recovered
+//   (a gap filled by a 'B' entry: replayed after an outage), duplicated; sequence restarts (station boots)
+//   the station's own reports on ws/messages: samples dropped by its queue or store-and-forward, MQTT outages
+// Samples stamped before the station knew the time (below TIME_VALID_2K) count in the sequence, not in the
+// latencies.
+// Build: g++ -std=c++17 -I.. -o lattrace LatTrace.cpp ../LatHist.cpp ../HalLinux.cpp ../Sensors.cpp ../SensConv.cpp
+
+#include "Config.h"
+#include "LatHist.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#define LT_LINE_LEN 2048
+#define LT_SEQS 65536  // the frame sequence number wraps at 16 bits
+
+// Latency stages, in report order
+enum { ST_TIP, ST_GUST, ST_QUEUE, ST_PUBLISH, ST_DELIVERY, ST_TOTAL, ST_TIP_END, ST_GUST_END, ST_BATCHED,
+  ST_COUNT };
+static const char* STAGE_NAMES[ST_COUNT] = { "tip -> capture", "gust -> capture", "capture -> queue",
+  "queue -> publish", "publish -> delivery", "capture -> delivery", "tip -> delivery", "gust -> delivery",
+  "capture -> delivery 'B'" };
+
+static LatHist _stage[ST_COUNT];  // microseconds
+static long long _minUs[ST_COUNT];  // least value seen (publish to delivery may be negative: clock offsets)
+static unsigned long _negative[ST_COUNT];  // values below zero, recorded as 0
+
+// Sequence of the traced samples
+static bool _seen[LT_SEQS];
+static bool _haveSeq = false;
+static uint16_t _expected;
+static unsigned long _traced = 0, _tracedB = 0, _lost = 0, _late = 0, _recovered = 0, _dups = 0, _boots = 0;
+static unsigned long _unsynced = 0;
+
+// Other publications
+static unsigned long _untraced = 0, _untracedB = 0, _outages = 0, _outageMs = 0;
+static unsigned long _queueDrops = 0, _fwdDrops = 0, _badLines = 0;
+
+/*********************************************************************************************************
+parseTime(): reads a decimal time to the microsecond (further digits ignored)
+parameters:
+  s: text: "<secs>[.<fraction>]"
+  us: receives the time in microseconds
+returns: const char*: the text after the time, NULL if there is no number
+**********************************************************************************************************/
+static const char* parseTime(const char* s, unsigned long long* us) {
+  if (!isdigit((unsigned char)*s)) return NULL;
+  unsigned long long secs = 0, frac = 0;
+  while (isdigit((unsigned char)*s)) secs = secs * 10 + (unsigned long long)(*s++ - '0');
+  int digits = 0;
+  if (*s == '.') {
+    s++;
+    for (; isdigit((unsigned char)*s); s++) {
+      if (digits < 6) {
+        frac = frac * 10 + (unsigned long long)(*s - '0');
+        digits++;
+      }
+    }
+  }
+  for (; digits < 6; digits++) frac *= 10;
+  *us = secs * 1000000ULL + frac;
+  return s;
+}
+
+static void record(int st, long long us) {
+  if (us < _minUs[st] || _stage[st].count() == 0) _minUs[st] = us;
+  if (us < 0) {
+    _negative[st]++;
+    us = 0;
+  }
+  _stage[st].record(us > 0xffffffffLL ? 0xffffffffUL : (uint32_t)us);
+}
+
+/*********************************************************************************************************
+onSeq(): follows the traced samples' sequence numbers: a number ahead of the one expected is a gap (samples
+lost unless they turn up later), one behind fills a gap (late, or recovered if it came in a 'B' message) or is a
+duplicate
+parameters:
+  seq: uint16_t: the sample's sequence number
+  inB: bool: it came in a 'B' message
+returns: void
+**********************************************************************************************************/
+static void onSeq(uint16_t seq, bool inB) {
+  if (!_haveSeq) {
+    _haveSeq = true;
+    _expected = seq;
+  }
+  uint16_t ahead = (uint16_t)(seq - _expected);
+  if (ahead < LT_SEQS / 2) {  // in order, or after a gap
+    _lost += ahead;
+    for (uint16_t s = _expected; s != (uint16_t)(seq + 1); s++) _seen[(uint16_t)(s + LT_SEQS / 2)] = false;
+    _seen[seq] = true;
+    _expected = seq + 1;
+  }
+  else if (_seen[seq]) _dups++;
+  else {
+    _seen[seq] = true;
+    if (inB) _recovered++;
+    else _late++;
+    if (_lost) _lost--;
+  }
+}
+
+/*********************************************************************************************************
+onTraced(): takes a traced 'R' message's trace into the stages and the sequence
+parameters:
+  recvUs: unsigned long long: when it was received (Unix time, microseconds)
+  trace: text after the ';': "<seq>,<capture>,<tip>,<gust>,<queue>,<publish>"
+returns: boolean: false if the trace does not parse
+**********************************************************************************************************/
+static bool onTraced(unsigned long long recvUs, const char* trace) {
+  unsigned int seq;
+  unsigned long long capUs;
+  long tip, gust, queue, publish;
+  int used = 0;
+  if (sscanf(trace, "%u,%n", &seq, &used) != 1) return false;
+  const char* p = parseTime(trace + used, &capUs);
+  if (!p || sscanf(p, ",%ld,%ld,%ld,%ld", &tip, &gust, &queue, &publish) != 4) return false;
+  long long total = (long long)(recvUs - 1000000ULL * SECS_1970_TO_2000) - (long long)capUs;
+  _traced++;
+  onSeq((uint16_t)seq, false);
+  if (capUs < 1000000ULL * TIME_VALID_2K) {  // seconds since boot: no latency
+    _unsynced++;
+    return true;
+  }
+  if (tip >= 0) {
+    record(ST_TIP, tip);
+    record(ST_TIP_END, tip + total);
+  }
+  if (gust >= 0) {
+    record(ST_GUST, gust);
+    record(ST_GUST_END, gust + total);
+  }
+  record(ST_QUEUE, queue);
+  record(ST_PUBLISH, publish - queue);
+  record(ST_DELIVERY, total - publish);
+  record(ST_TOTAL, total);
+  return true;
+}
+
+/*********************************************************************************************************
+onBatch(): takes a 'B' message's entries into the sequence (and their capture to delivery), or counts them as
+untraced
+parameters:
+  recvUs: unsigned long long: when it was received (Unix time, microseconds)
+  entries: text after the 'B': "<t0>;<dt>,<fields>[:<seq>,<capture>];..."
+returns: boolean: false if an entry's trace does not parse
+**********************************************************************************************************/
+static bool onBatch(unsigned long long recvUs, const char* entries) {
+  for (const char* e = strchr(entries, ';'); e; e = strchr(e + 1, ';')) {
+    const char* colon = strchr(e, ':');
+    const char* next = strchr(e + 1, ';');
+    if (!colon || (next && colon > next)) {
+      _untracedB++;
+      continue;
+    }
+    unsigned int seq;
+    unsigned long long capUs;
+    int used = 0;
+    if (sscanf(colon + 1, "%u,%n", &seq, &used) != 1 || !parseTime(colon + 1 + used, &capUs)) return false;
+    _tracedB++;
+    onSeq((uint16_t)seq, true);
+    if (capUs < 1000000ULL * TIME_VALID_2K) _unsynced++;
+    else record(ST_BATCHED, (long long)(recvUs - 1000000ULL * SECS_1970_TO_2000) - (long long)capUs);
+  }
+  return true;
+}
+
+/*********************************************************************************************************
+onMessage(): picks the station's loss and outage reports out of ws/messages; a sequence restart (boot) is
+announced by its first sample's message
+parameters: text: the message after its 'M'
+returns: void
+**********************************************************************************************************/
+static void onMessage(const char* text) {
+  unsigned long n, held;
+  if (sscanf(text, "Realtime samples dropped: %lu", &n) == 1) _queueDrops = n;
+  else if (sscanf(text, "Samples held: %lu; dropped: %lu", &held, &n) == 2) _fwdDrops = n;
+  else if (sscanf(text, "MQTT up after %lu ms", &n) == 1) {
+    _outages++;
+    _outageMs += n;
+  }
+  else if (strncmp(text, "First sample", 12) == 0) {
+    _boots++;
+    _haveSeq = false;
+    memset(_seen, 0, sizeof(_seen));
+  }
+}
+
+static void report() {
+  printf("traced samples %lu ('R' %lu, 'B' %lu): lost %lu, late %lu, recovered %lu, duplicated %lu; "
+    "sequence restarts %lu; unsynced %lu\n", _traced + _tracedB, _traced, _tracedB, _lost, _late, _recovered, _dups,
+    _boots, _unsynced);
+  printf("untraced: 'R' %lu, 'B' entries %lu; station drops: queue %lu, store-and-forward %lu; "
+    "MQTT outages %lu (%lu ms)\n", _untraced, _untracedB, _queueDrops, _fwdDrops, _outages, _outageMs);
+  printf("%-24s %8s %10s %10s %10s %10s %10s\n", "stage (ms)", "count", "min", "p50", "p90", "p99", "max");
+  for (int st = 0; st < ST_COUNT; st++) {
+    LatHist& h = _stage[st];
+    if (h.count() == 0) continue;
+    printf("%-24s %8lu %10.3f %10.3f %10.3f %10.3f %10.3f", STAGE_NAMES[st], (unsigned long)h.count(),
+      _minUs[st] / 1000.0, h.percentile(50) / 1000.0, h.percentile(90) / 1000.0, h.percentile(99) / 1000.0,
+      h.max() / 1000.0);
+    if (_negative[st]) printf("  (%lu below 0)", _negative[st]);
+    printf("\n");
+  }
+  if (_badLines) printf("%lu lines not understood\n", _badLines);
+  fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+  unsigned long long everyUs = 0, nextUs = 0;
+  if (argc == 3 && strcmp(argv[1], "-r") == 0) everyUs = 1000000ULL * strtoul(argv[2], NULL, 10);
+  else if (argc != 1) {
+    fprintf(stderr, "usage: lattrace [-r <report every secs>] < publications\n");
+    return 2;
+  }
+  static char line[LT_LINE_LEN];
+  while (fgets(line, sizeof(line), stdin)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    unsigned long long recvUs;
+    char topic[QT_LEN];
+    int used = 0;
+    const char* p = parseTime(line, &recvUs);
+    if (!p || sscanf(p, " %31s %n", topic, &used) != 1) {
+      _badLines++;
+      continue;
+    }
+    const char* payload = p + used;
+    if (strcmp(topic, "ws/messages") == 0 && payload[0] == 'M') onMessage(payload + 1);
+    else if (strcmp(topic, "ws/csv") == 0 && payload[0] == 'R') {
+      const char* trace = strchr(payload, ';');
+      if (!trace) _untraced++;
+      else if (!onTraced(recvUs, trace + 1)) _badLines++;
+    }
+    else if (strcmp(topic, "ws/csv") == 0 && payload[0] == 'B') {
+      if (!onBatch(recvUs, payload + 1)) _badLines++;
+    }
+    if (everyUs) {
+      if (nextUs == 0) nextUs = recvUs + everyUs;
+      else if (recvUs >= nextUs) {
+        report();
+        nextUs += everyUs * ((recvUs - nextUs) / everyUs + 1);
+      }
+    }
+  }
+  report();
+  return 0;
+}
@@ -0,0 +1,222 @@
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// LoopBench: host microbenchmarks of the sampling loop, in nanoseconds per call on this machine. The virtual clock
+// only paces the station; the time spent in its code is measured with the host's monotonic clock.
+// The station runs on the Linux backend with a steady wind, a rain shower, the I2C device models and the ADC at its
+// real rate. Each scheduled job (the former ZONE blocks of loop()) is timed on its own, as are the whole sampling
+// tick, the network side's tick, getAndPostRT()'s successor (the "rt" job plus the network tick that posts its
+// sample) and Chrono::nowISO().
+// The samples the station posted are then encoded again, as a binary frame (encodeFrame()) and as the 'R' CSV
+// message (frameToCSV()), to compare the two encodings' time and their bytes on air: each MQTT PUBLISH (QoS 0) adds
+// a fixed header (2 bytes at these sizes) and the topic with its 2 byte length to the payload.
+//   loopbench [-t <ticks>] [-c <csv file> [-l <label>]]
+// -c appends one line per measurement, "<label>,<name>,<calls>,<ns per call>", so that runs at successive commits
+// (label: the commit) can be compared. The numbers are the host's: it is their changes that carry over to the ESP32.
+// Build: see CMakeLists.txt (the bench target runs it)
+
+#include "HalLinux.h"
+#include "Station.h"
+#include "Telemetry.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LB_START_2K (8991UL * SECS_PER_DAY)  // 13/08/2024
+#define LB_TICKS (4 * 3600L)  // an hour of station time
+#define LB_WIND_US 100000ULL  // an anemometer pulse every 0.1 sec
+#define LB_TIP_US 60000000ULL  // a bucket tip every minute
+#define LB_MAX (SCHED_MAX_JOBS + 7)
+#define LB_SAMPLES 1024  // samples kept for the encoding comparison
+#define LB_PASSES 16  // passes over them
+#define TICK_US (LOOP_TIME * 1000ULL)
+
+// Structure holding one measurement
+struct measure {
+  char name[32];
+  unsigned long calls;
+  double ns;  // total
+  double maxNs;
+};
+
+static measure _m[LB_MAX];
+static int _count = 0;
+static unsigned long _published = 0;
+static rtFrame _samples[LB_SAMPLES];
+static int _numSamples = 0;
+
+static void onPublish(const char* topic, const byte* payload, unsigned int length) {
+  _published++;
+  if (strcmp(topic, "ws/bin") == 0 && length == FRAME_LEN && _numSamples < LB_SAMPLES &&
+    decodeFrame(payload, length, &_samples[_numSamples])) _numSamples++;
+}
+
+// onAir(): bytes of an MQTT PUBLISH at QoS 0: fixed header (type, remaining length), topic, payload
+static unsigned int onAir(const char* topic, unsigned int payload) {
+  unsigned int remaining = 2 + strlen(topic) + payload;
+  unsigned int lenBytes = 1;
+  for (unsigned int r = remaining; r > 127; r >>= 7) lenBytes++;
+  return 1 + lenBytes + remaining;
+}
+
+static double nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int addMeasure(const char* name) {
+  measure& m = _m[_count];
+  snprintf(m.name, sizeof(m.name), "%s", name);
+  m.calls = 0;
+  m.ns = 0;
+  m.maxNs = 0;
+  return _count++;
+}
+
+static void record(int ix, double ns) {
+  measure& m = _m[ix];
+  m.calls++;
+  m.ns += ns;
+  if (ns > m.maxNs) m.maxNs = ns;
+}
+
+// edge(): one switch closure (see host/Simulator.cpp)
+static void edge(int pin) {
+  halSetPin(pin, LOW);
+  halSetPin(pin, HIGH);
+}
+
+int main(int argc, char** argv) {
+  long ticks = LB_TICKS;
+  const char* csvPath = NULL;
+  const char* label = "local";
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-t") == 0) ticks = atol(argv[i + 1]);
+    else if (strcmp(argv[i], "-c") == 0) csvPath = argv[i + 1];
+    else if (strcmp(argv[i], "-l") == 0) label = argv[i + 1];
+    else {
+      fprintf(stderr, "usage: loopbench [-t <ticks>] [-c <csv file> [-l <label>]]\n");
+      return 2;
+    }
+  }
+
+  halSetFsRoot("bench_fs");
+  halSetPublishHook(onPublish);
+  halSetAHT(12.5f, 70.0f);
+  halSetBMP(101325.0f);
+  halSetLux(BHA_ADDR, 800.0f);
+  halSetLux(BHB_ADDR, 300.0f);
+  halSetAnalog(WDPin, 1500);
+  halSetAnalogNoise(WDPin, 200);
+  halSetAnalog(VoltsPin, 2400);
+  halSetAnalogNoise(VoltsPin, 8);
+  static Station station;
+  station.begin(LB_START_2K);
+  station.setFrameMode(FRAME_MODE_BOTH);  // frames to compare the encodings with (and both posted, as on a switch)
+  Sampler& sampler = station.sampler();
+  Timebase tb;
+  tb.begin(LB_START_2K);
+  Chrono chrono;
+  chrono.begin(tb);
+
+  int jobIx[SCHED_MAX_JOBS];
+  char name[32];
+  for (int id = 0; id < sampler.jobs(); id++) {
+    snprintf(name, sizeof(name), "job %s", sampler.job(id).name);
+    jobIx[id] = addMeasure(name);
+  }
+  int tickIx = addMeasure("sampling tick (all jobs)");
+  int netIx = addMeasure("network tick");
+  int postIx = addMeasure("network tick posting a sample");
+  int rtIx = addMeasure("getAndPostRT (rt job + post)");
+  int isoIx = addMeasure("Chrono::nowISO");
+
+  unsigned long long nextTick = halMicros64() + TICK_US;
+  unsigned long long nextPulse = halMicros64() + LB_WIND_US, nextTip = halMicros64() + LB_TIP_US;
+  volatile char sink = 0;
+  for (long tick = 0; tick < ticks; tick++) {
+    while (nextPulse <= nextTick || nextTip <= nextTick) {  // the pulses before this tick, at their own times
+      if (nextPulse <= nextTip) {
+        halSetMicros(nextPulse);
+        edge(RevsPin);
+        nextPulse += LB_WIND_US;
+      }
+      else {
+        halSetMicros(nextTip);
+        edge(RainPin);
+        nextTip += LB_TIP_US;
+      }
+    }
+    halSetMicros(nextTick);
+    nextTick += TICK_US;
+
+    int slot = (int)(tick % MAX_LOOP_COUNT);
+    double tickNs = 0, rtNs = -1;
+    for (int id = 0; id < sampler.jobs(); id++) {
+      const schedJob& jb = sampler.job(id);
+      if (slot % jb.period != jb.phase) continue;
+      double t0 = nowNs();
+      sampler.runJob(id);
+      double ns = nowNs() - t0;
+      record(jobIx[id], ns);
+      tickNs += ns;
+      if (id == JOB_RT) rtNs = ns;
+    }
+    record(tickIx, tickNs);
+    double t0 = nowNs();
+    station.netTick();
+    double ns = nowNs() - t0;
+    record(netIx, ns);
+    if (rtNs >= 0) {
+      record(postIx, ns);
+      record(rtIx, rtNs + ns);
+    }
+    t0 = nowNs();
+    sink = sink + chrono.nowISO(TRUNC_NONE)[18];
+    record(isoIx, nowNs() - t0);
+  }
+
+  // The same samples in either encoding
+  int frameIx = addMeasure("encodeFrame");
+  int csvIx = addMeasure("'R' CSV (frameToCSV)");
+  byte frame[FRAME_LEN];
+  char csvBuf[BUF_LEN];
+  unsigned long frameBytes = 0, csvBytes = 0;
+  for (int i = 0; i < _numSamples * LB_PASSES; i++) {
+    const rtFrame& fr = _samples[i % _numSamples];
+    double t0 = nowNs();
+    int len = encodeFrame(fr, frame);
+    record(frameIx, nowNs() - t0);
+    frameBytes += onAir("ws/bin", len);
+    t0 = nowNs();
+    MsgWriter mw(csvBuf, sizeof(csvBuf));
+    mw.put('R');
+    frameToCSV(fr, mw);
+    record(csvIx, nowNs() - t0);
+    csvBytes += onAir("ws/csv", mw.length());
+    sink = sink + frame[len - 1] + csvBuf[mw.length() - 1];
+  }
+
+  printf("LoopBench: %ld ticks (%ld s of station time), %lu publications\n", ticks, ticks * LOOP_TIME / 1000,
+    _published);
+  printf("%-32s %8s %12s %12s\n", "measurement", "calls", "ns/call", "max ns");
+  FILE* csv = csvPath ? fopen(csvPath, "a") : NULL;
+  for (int i = 0; i < _count; i++) {
+    const measure& m = _m[i];
+    double mean = m.calls ? m.ns / m.calls : 0;
+    printf("%-32s %8lu %12.0f %12.0f\n", m.name, m.calls, mean, m.maxNs);
+    if (csv) fprintf(csv, "%s,%s,%lu,%.0f\n", label, m.name, m.calls, mean);
+  }
+  if (_numSamples) {
+    printf("Bytes on air per sample (MQTT PUBLISH, QoS 0): frame %.1f, 'R' CSV %.1f (%d samples)\n",
+      (double)frameBytes / (_numSamples * LB_PASSES), (double)csvBytes / (_numSamples * LB_PASSES), _numSamples);
+    if (csv) {
+      fprintf(csv, "%s,bytes on air: frame,%d,%.1f\n", label, _numSamples,
+        (double)frameBytes / (_numSamples * LB_PASSES));
+      fprintf(csv, "%s,bytes on air: 'R' CSV,%d,%.1f\n", label, _numSamples,
+        (double)csvBytes / (_numSamples * LB_PASSES));
+    }
+  }
+  if (csv) fclose(csv);
+  return 0;
+}
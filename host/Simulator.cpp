@@ -0,0 +1,415 @@
+// ----------------------------------- Version of 17/10/2026 ------------------------------------------------
+// Simulator: runs the real station code (Station, Sampler, RainWind, Sensors, Chrono, ...) on the host backend of
+// the HAL, fed by a trace, under the virtual clock: a month of station time takes seconds.
+//   simulator [options] < trace        runs the trace; every MQTT publication is written as
+//                                      "<secs> <topic> <payload>" (binary payloads in hex), secs from the start
+//                                      (or, with -u, the Unix time it reaches a subscriber)
+//   simulator synth <days> [seed]      writes a synthesized trace of that many days on stdout
+// Options:
+//   -s <secs>   start time, seconds since 1/1/2000 (default: 13/08/2024 00:00)
+//   -f <dir>    history log directory (default "sim_fs"; its log is erased first, so runs repeat exactly)
+//   -a <hz>     continuous ADC rate (default 400: three DMA frames a second; the real 20 kHz would dominate a
+//               long run)
+//   -o <file>   publications to a file instead of stdout ("-" for none)
+//   -r <seed>   seed of halRandom() (default 1)
+//   -c <ppm>    SNTP on: the crystal runs this fast (decimals allowed; default: no SNTP server)
+//   -t <ms>     SNTP on: the station boots this far behind the true time (default 0), or "none": it boots
+//               without the time (samples stamped since boot until the first sync)
+//   -p <units>  pulse counter units the station can have (default 2: the rain gauge's, and the anemometer's if
+//               WIND_PULSE_COUNTER; 0: both on interrupts)
+//   -u <ms>     publications stamped with the true Unix time (to the microsecond) this long after they are made,
+//               as mosquitto_sub -F '%U %t %p' stamps them: the output then feeds host/LatTrace.cpp
+// Trace: one event per line, in time order, "<secs> <event> [args]" (secs from the start, decimals allowed);
+// blank lines and lines starting with '#' are ignored:
+//   pulse                 one anemometer pulse          wind <hz>        pulses at a steady rate from now on
+//   tip                   one rain bucket tip           rain <per hour>  tips at a steady rate from now on
+//   vane <raw>            vane ADC value (0-4095)       volts <raw>      battery ADC value (0-4095)
+//   aht <C> <%RH>         AHT20 reading                 bmp <Pa>         BMP085 pressure
+//   lux <luxA> <luxB>     BH1750 readings               broker up|down   MQTT broker reachable or not
+//   shed <request>        message from the Shed         end              stops the run (else: end of trace)
+//   ntp up|down           SNTP server reachable or not
+//   bounce <n> [<us>]     each anemometer pulse from now on bounces: n more closures, <us> apart (default 300;
+//                         n 0: clean again), not counted as pulses fed
+// At the end a summary goes to stderr: simulated and wall time, tick throughput, publications per topic, and the
+// revs and tips fed against those in the ws/day blocks, for regression checks of the rain and wind results,
+// and with SNTP on, the clock's last offset and drift estimate against the crystal error set. Then each complete
+// day of the run is checked against its ws/day block: a missing block, or revs (beyond SIM_DAY_REVS) or tips that
+// differ from those fed in that day, are reported and make the exit status 1.
+// Build: g++ -O2 -std=c++17 -I.. -o simulator Simulator.cpp $(ls ../*.cpp | grep -v Comms)
+
+#include "HalLinux.h"
+#include "Station.h"
+#include "DayCodec.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+
+#define SIM_START_2K (8991UL * SECS_PER_DAY)  // 13/08/2024
+#define SIM_ADC_HZ 400
+#define SIM_TOPICS 12
+#define SIM_LINE_LEN 256
+#define SIM_DAYS 400  // days of a run checked against their ws/day blocks
+#define SIM_DAY_SLACK_S 60  // a day is complete (its block due) this long after its end
+#define SIM_DAY_REVS 2  // revs a block may differ from those fed in its day (pulses at midnight, either side)
+#define SIM_BOUNCE_US 300  // default time between a bouncing reed switch's closures
+#define TICK_US (LOOP_TIME * 1000ULL)
+#define NEVER 0xffffffffffffffffULL
+
+// Structure counting the publications on one topic
+struct topicCount {
+  char topic[QT_LEN];
+  unsigned long count;
+  unsigned long bytes;
+};
+
+static FILE* _out = stdout;
+static unsigned long long _startUs;
+static unsigned long long _trueStartUs;  // true time at _startUs (microseconds since 1/1/2000) without SNTP
+static bool _trueRef = false;  // with it: the HAL's reference is the true time
+static long long _deliverUs = -1;  // -u: broker delivery delay (microseconds)
+static topicCount _topics[SIM_TOPICS];
+static int _topicCount = 0;
+static unsigned long _dayRevs = 0, _dayTips = 0, _dayBlocks = 0;
+
+// Structure holding one day's pulses and tips as fed (by the true time) and as its ws/day block reports them
+struct dayCheck {
+  unsigned long fedRevs, fedTips;
+  unsigned long revs, tips;
+  int blocks;
+};
+
+static dayCheck _days[SIM_DAYS];
+static unsigned long _firstDay2k;
+
+/*********************************************************************************************************
+onPublish(): publish hook: writes the publication, counts it and totals the ws/day blocks
+**********************************************************************************************************/
+static void onPublish(const char* topic, const byte* payload, unsigned int length) {
+  int i;
+  for (i = 0; i < _topicCount && strcmp(_topics[i].topic, topic) != 0; i++);
+  if (i == _topicCount && _topicCount < SIM_TOPICS) {
+    strncpy(_topics[i].topic, topic, QT_LEN - 1);
+    _topicCount++;
+  }
+  if (i < _topicCount) {
+    _topics[i].count++;
+    _topics[i].bytes += length;
+  }
+  bool binary = strcmp(topic, "ws/bin") == 0 || strcmp(topic, "ws/day") == 0;
+  if (binary && strcmp(topic, "ws/day") == 0) {
+    dayRecs d;
+    if (decodeDay(payload, length, &d)) {
+      unsigned long revs = 0, tips = 0;
+      for (int h = 0; h < HPD; h++) {
+        revs += d.hours[h].rw.revsHr;
+        tips += d.hours[h].rw.bucketsHr;
+      }
+      _dayRevs += revs;
+      _dayTips += tips;
+      _dayBlocks++;
+      if (d.day2k >= _firstDay2k && d.day2k - _firstDay2k < SIM_DAYS) {  // a resent or requested day: the latest
+        dayCheck& dc = _days[d.day2k - _firstDay2k];
+        dc.revs = revs;
+        dc.tips = tips;
+        dc.blocks++;
+      }
+    }
+  }
+  if (!_out) return;
+  unsigned long long us = halMicros64() - _startUs;
+  if (_deliverUs >= 0) {
+    unsigned long long trueUs = _trueRef ? halTrueUs2k() : _trueStartUs + us;
+    unsigned long long unixUs = trueUs + _deliverUs + 1000000ULL * SECS_1970_TO_2000;
+    fprintf(_out, "%llu.%06llu %s ", unixUs / 1000000ULL, unixUs % 1000000ULL, topic);
+  }
+  else fprintf(_out, "%llu.%03llu %s ", us / 1000000ULL, (us / 1000ULL) % 1000ULL, topic);
+  if (binary) {
+    for (unsigned int b = 0; b < length; b++) fprintf(_out, "%02x", payload[b]);
+  }
+  else fwrite(payload, 1, length, _out);
+  fputc('\n', _out);
+}
+
+/*********************************************************************************************************
+edge(): one switch closure on an interrupt pin: both edges at the same instant, so the ISR's bounce margin
+lets only the first count, as with a clean reed switch; a pulse counter counts the falling edge, which comes
+long after the pin's previous change, so its glitch filter passes it
+**********************************************************************************************************/
+static void edge(int pin) {
+  halSetPin(pin, LOW);
+  halSetPin(pin, HIGH);
+}
+
+// feed(): one pulse or tip, counted in its (true) day for checkDays()
+static void feed(int pin, unsigned long long t, unsigned long long* count) {
+  edge(pin);
+  (*count)++;
+  unsigned long long day = (_trueStartUs + (t - _startUs)) / (1000000ULL * SECS_PER_DAY) - _firstDay2k;
+  if (day < SIM_DAYS) {
+    if (pin == RevsPin) _days[day].fedRevs++;
+    else _days[day].fedTips++;
+  }
+}
+
+/*********************************************************************************************************
+checkDays(): checks the ws/day block of every complete day of the run against what was fed in that day: a
+missing block (lost when the broker was down at midnight, say), or revs or tips that differ, fail the run
+parameters: endUs: uint64_t: true time at the end of the run (microseconds since 1/1/2000)
+returns: int: days that failed
+**********************************************************************************************************/
+static int checkDays(unsigned long long endUs) {
+  int checked = 0, failed = 0;
+  for (unsigned long day = 0; day < SIM_DAYS; day++) {
+    unsigned long long dayEndUs = 1000000ULL * ((_firstDay2k + day + 1) * SECS_PER_DAY + SIM_DAY_SLACK_S);
+    if (dayEndUs > endUs) break;
+    if (day == 0 && _trueStartUs % (1000000ULL * SECS_PER_DAY) > 1000000ULL * SIM_DAY_SLACK_S) continue;  // joined late
+    const dayCheck& dc = _days[day];
+    long dRevs = (long)dc.revs - (long)dc.fedRevs;
+    checked++;
+    if (dc.blocks == 0) fprintf(stderr, "day %lu: MISSING ws/day block\n", _firstDay2k + day);
+    else if (dRevs > SIM_DAY_REVS || dRevs < -SIM_DAY_REVS || dc.tips != dc.fedTips) {
+      fprintf(stderr, "day %lu: MISMATCH fed %lu pulses, %lu tips; block %lu revs, %lu tips\n", _firstDay2k + day,
+        dc.fedRevs, dc.fedTips, dc.revs, dc.tips);
+    }
+    else continue;
+    failed++;
+  }
+  fprintf(stderr, "days checked against their ws/day blocks: %d; failed: %d\n", checked, failed);
+  return failed;
+}
+
+static unsigned long long ratePeriod(double perSec) {
+  return perSec > 0 ? (unsigned long long)(1e6 / perSec) : NEVER;
+}
+
+/*********************************************************************************************************
+readEvent(): reads the next event line of the trace
+parameters:
+  f: trace
+  atUs: receives the event time (microseconds from the start)
+  ev: receives the event name
+  args: receives the rest of the line
+returns: boolean: false at the end of the trace
+**********************************************************************************************************/
+static bool readEvent(FILE* f, unsigned long long* atUs, char* ev, char* args) {
+  char line[SIM_LINE_LEN];
+  while (fgets(line, sizeof(line), f)) {
+    double secs;
+    int used = 0;
+    if (line[0] == '#' || sscanf(line, "%lf %31s %n", &secs, ev, &used) < 2) continue;
+    strcpy(args, line + used);
+    args[strcspn(args, "\r\n")] = '\0';
+    *atUs = (unsigned long long)(secs * 1e6 + 0.5);
+    return true;
+  }
+  return false;
+}
+
+static int simulate(int argc, char** argv) {
+  unsigned long start2k = SIM_START_2K;
+  const char* fsDir = "sim_fs";
+  unsigned long adcHz = SIM_ADC_HZ;
+  unsigned int seed = 1;
+  double ppm = 0, behindMs = 0;
+  bool ntp = false, timeless = false;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-s") == 0) start2k = strtoul(argv[i + 1], NULL, 10);
+    else if (strcmp(argv[i], "-f") == 0) fsDir = argv[i + 1];
+    else if (strcmp(argv[i], "-a") == 0) adcHz = strtoul(argv[i + 1], NULL, 10);
+    else if (strcmp(argv[i], "-r") == 0) seed = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+    else if (strcmp(argv[i], "-p") == 0) halSetCounterUnits(atoi(argv[i + 1]));
+    else if (strcmp(argv[i], "-o") == 0) _out = strcmp(argv[i + 1], "-") == 0 ? NULL : fopen(argv[i + 1], "w");
+    else if (strcmp(argv[i], "-u") == 0) _deliverUs = (long long)(1000 * atof(argv[i + 1]));
+    else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "-t") == 0) {
+      *(argv[i][1] == 'c' ? &ppm : &behindMs) = atof(argv[i + 1]);
+      timeless = timeless || strcmp(argv[i + 1], "none") == 0;
+      ntp = true;
+    }
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (argc % 2 == 0) {
+    fprintf(stderr, "option %s needs a value\n", argv[argc - 1]);
+    return 2;
+  }
+  char path[HIST_PATH_LEN + 16];
+  for (int seg = 0; seg < HIST_SEGMENTS; seg++) {
+    snprintf(path, sizeof(path), "%s/hist%d.log", fsDir, seg);
+    remove(path);
+  }
+  srand(seed);
+  halSetFsRoot(fsDir);
+  halSetAdcHz(adcHz);
+  halSetPublishHook(onPublish);
+  if (ntp) halSetTimeRef(1000000ULL * start2k + (unsigned long long)(1000 * behindMs) - halMicros64(), (long)(ppm * 1000));
+  static Station station;
+  unsigned long long bootUs = halMicros64();  // the station's clock starts at start2k here
+  station.begin(timeless ? 0UL : start2k);
+  _startUs = halMicros64();
+  _trueStartUs = 1000000ULL * start2k + (_startUs - bootUs);
+  _trueRef = ntp;
+  _firstDay2k = (unsigned long)(_trueStartUs / (1000000ULL * SECS_PER_DAY));
+
+  unsigned long long nextTick = _startUs + TICK_US, nextPulse = NEVER, nextTip = NEVER;
+  unsigned long long pulsePeriod = NEVER, tipPeriod = NEVER;
+  unsigned long long nextBounce = NEVER, bounceUs = SIM_BOUNCE_US;
+  int bounceEdges = 0, bounceLeft = 0;
+  unsigned long long ticks = 0, pulses = 0, tips = 0, evUs = 0;
+  char ev[32], args[SIM_LINE_LEN];
+  bool more = readEvent(stdin, &evUs, ev, args);
+  clock_t wall0 = clock();
+  while (more) {  // the run ends with the trace
+    unsigned long long at = _startUs + evUs;
+    unsigned long long t = at;
+    if (nextPulse < t) t = nextPulse;
+    if (nextTip < t) t = nextTip;
+    if (nextTick < t) t = nextTick;
+    if (nextBounce < t) t = nextBounce;
+    halSetMicros(t);
+    bool closed = false;  // an anemometer pulse, which may bounce
+    if (t == nextBounce) {
+      edge(RevsPin);
+      nextBounce = --bounceLeft > 0 ? t + bounceUs : NEVER;
+    }
+    if (t == nextPulse) {
+      feed(RevsPin, t, &pulses);
+      closed = true;
+      nextPulse += pulsePeriod;
+    }
+    if (t == nextTip) {
+      feed(RainPin, t, &tips);
+      nextTip += tipPeriod;
+    }
+    if (t == at) {
+      if (strcmp(ev, "end") == 0) break;
+      else if (strcmp(ev, "pulse") == 0) {
+        feed(RevsPin, t, &pulses);
+        closed = true;
+      }
+      else if (strcmp(ev, "tip") == 0) feed(RainPin, t, &tips);
+      else if (strcmp(ev, "wind") == 0) {
+        pulsePeriod = ratePeriod(atof(args));
+        nextPulse = pulsePeriod == NEVER ? NEVER : t + pulsePeriod;
+      }
+      else if (strcmp(ev, "rain") == 0) {
+        tipPeriod = ratePeriod(atof(args) / SECS_PER_HOUR);
+        nextTip = tipPeriod == NEVER ? NEVER : t + tipPeriod;
+      }
+      else if (strcmp(ev, "vane") == 0) halSetAnalog(WDPin, atoi(args));
+      else if (strcmp(ev, "volts") == 0) halSetAnalog(VoltsPin, atoi(args));
+      else if (strcmp(ev, "aht") == 0) {
+        float c = 0, rh = 0;
+        sscanf(args, "%f %f", &c, &rh);
+        halSetAHT(c, rh);
+      }
+      else if (strcmp(ev, "bmp") == 0) halSetBMP((float)atof(args));
+      else if (strcmp(ev, "lux") == 0) {
+        float a = 0, b = 0;
+        sscanf(args, "%f %f", &a, &b);
+        halSetLux(BHA_ADDR, a);
+        halSetLux(BHB_ADDR, b);
+      }
+      else if (strcmp(ev, "broker") == 0) halSetBrokerUp(strcmp(args, "down") != 0);
+      else if (strcmp(ev, "shed") == 0) station.onShedMessage((const byte*)args, strlen(args));
+      else if (strcmp(ev, "ntp") == 0) halSetNtpUp(strcmp(args, "down") != 0);
+      else if (strcmp(ev, "bounce") == 0) {
+        double us = SIM_BOUNCE_US;
+        bounceEdges = 0;
+        sscanf(args, "%d %lf", &bounceEdges, &us);
+        bounceUs = us >= 1 ? (unsigned long long)us : 1;
+      }
+      else fprintf(stderr, "unknown event at %.3f: %s\n", evUs / 1e6, ev);
+      more = readEvent(stdin, &evUs, ev, args);
+    }
+    if (closed && bounceEdges > 0) {
+      bounceLeft = bounceEdges;
+      nextBounce = t + bounceUs;
+    }
+    if (t == nextTick) {
+      station.tick();
+      ticks++;
+      nextTick += TICK_US;
+    }
+  }
+  double wall = (double)(clock() - wall0) / CLOCKS_PER_SEC;
+  double simSecs = (halMicros64() - _startUs) / 1e6;
+  if (_out && _out != stdout) fclose(_out);
+
+  fprintf(stderr, "simulated %.0f s (%.2f days) in %.2f s wall: x%.0f, %.0f ticks/s\n", simSecs, simSecs / SECS_PER_DAY,
+    wall, wall > 0 ? simSecs / wall : 0, wall > 0 ? ticks / wall : 0);
+  for (int i = 0; i < _topicCount; i++) {
+    fprintf(stderr, "  %-14s %8lu messages %10lu bytes\n", _topics[i].topic, _topics[i].count, _topics[i].bytes);
+  }
+  fprintf(stderr, "fed: %llu pulses, %llu tips; ws/day blocks: %lu, %lu revs, %lu tips\n", pulses, tips, _dayBlocks,
+    _dayRevs, _dayTips);
+  if (ntp) {
+    const clockStats& cs = station.timeStats();
+    fprintf(stderr, "clock: %lu syncs, %lu steps; last offset %ld us; drift %ld ppb (crystal %.0f ppb)\n", cs.syncs,
+      cs.steps, cs.offsetUs, cs.driftPpb, -ppm * 1000);
+  }
+  return checkDays(_trueStartUs + (halMicros64() - _startUs)) ? 1 : 0;
+}
+
+// Synthesized trace ----------------------------------------------------------------------------------
+
+static double uniform() { return rand() / (RAND_MAX + 1.0); }
+
+/*********************************************************************************************************
+synth(): writes a synthesized trace: a daily cycle of temperature, humidity, light and battery, pressure on a
+random walk, wind from a mean-reverting random level with gusts (a new rate every 10 secs) and a veering vane,
+rain showers and a few broker outages
+parameters:
+  days: int: length of the trace
+  seed: unsigned int: random seed
+returns: int: exit code
+**********************************************************************************************************/
+static int synth(int days, unsigned int seed) {
+  srand(seed);
+  double pa = 101000, level = 3, dir = 225, rainLeft = 0;
+  long brokerUpAt = -1;
+  printf("# synthesized trace: %d days, seed %u\n", days, seed);
+  for (long s = 0; s < (long)days * SECS_PER_DAY; s += 10) {
+    double dayFrac = (s % SECS_PER_DAY) / (double)SECS_PER_DAY;
+    double sun = sin(2 * M_PI * (dayFrac - 0.25));  // peaks at noon
+    level += 0.02 * (4 + 2 * sun - level) + 0.3 * (uniform() - 0.5);  // revs per second
+    if (level < 0) level = 0;
+    double hz = level * (uniform() < 0.05 ? 1.8 : 0.8 + 0.4 * uniform());  // the odd gust
+    printf("%ld wind %.2f\n", s, hz);
+    dir += 8 * (uniform() - 0.5);
+    dir = fmod(dir + 360, 360);
+    printf("%ld vane %d\n", s, (int)(dir * 4096 / 360) & 4095);
+    if (s % 600 == 0) {
+      pa += 40 * (uniform() - 0.5);
+      if (pa < 96000) pa = 96000;
+      if (pa > 104000) pa = 104000;
+      printf("%ld aht %.1f %.1f\n", s, 12 + 6 * sun + uniform(), 75 - 15 * sun + 2 * uniform());
+      printf("%ld bmp %.0f\n", s, pa);
+      printf("%ld lux %.0f %.0f\n", s, sun > 0 ? 20000 * sun : 0, sun > 0 ? 8000 * sun : 0);
+      printf("%ld volts %d\n", s, 2300 + (int)(200 * (sun > 0 ? sun : 0)));
+      if (rainLeft > 0 && (rainLeft -= 600) <= 0) printf("%ld rain 0\n", s);
+      else if (rainLeft <= 0 && uniform() < 0.01) {
+        rainLeft = 1800 + 7200 * uniform();
+        printf("%ld rain %.0f\n", s, 20 + 100 * uniform());
+      }
+    }
+    if (brokerUpAt < 0 && uniform() < 0.00003) {
+      brokerUpAt = s + 60 + (long)(5400 * uniform());
+      printf("%ld broker down\n", s);
+    }
+    else if (brokerUpAt >= 0 && s >= brokerUpAt) {
+      printf("%ld broker up\n", s);
+      brokerUpAt = -1;
+    }
+  }
+  printf("%ld end\n", (long)days * SECS_PER_DAY);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && strcmp(argv[1], "synth") == 0) return synth(atoi(argv[2]), argc > 3 ? (unsigned int)atoi(argv[3]) : 1);
+  return simulate(argc, argv);
+}